@@ -19,6 +19,8 @@
 
 package org.a11y.BrlAPI;
 
+import java.nio.ByteBuffer;
+
 public class Brlapi extends Native implements Constants {
   protected final ConnectionSettings settings;
   protected final int fileDescriptor;
@@ -87,4 +89,14 @@ public class Brlapi extends Native implements Constants {
     }
     writeTextNative(cursor, text);
   }
+
+  public void writeDots (ByteBuffer dots) throws Error {
+    if (dots.isDirect()) {
+      writeDotsNative(dots);
+    } else {
+      byte array[] = new byte[dots.remaining()];
+      dots.duplicate().get(array);
+      writeDots(array);
+    }
+  }
 }
@@ -19,6 +19,8 @@
 
 package org.a11y.BrlAPI;
 
+import java.nio.ByteBuffer;
+
 public class Native {
   static {
     System.loadLibrary("brlapi_java");
@@ -42,6 +44,7 @@ public class Native {
 
   protected native void writeTextNative (int cursor, String text) throws Error;
   public native void writeDots (byte dots[]) throws Error;
+  protected native void writeDotsNative (ByteBuffer dots) throws Error;
   public native void write (WriteArguments arguments) throws Error;
 
   public native long readKey (boolean wait) throws Error;
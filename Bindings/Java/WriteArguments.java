@@ -19,6 +19,8 @@
 
 package org.a11y.BrlAPI;
 
+import java.nio.ByteBuffer;
+
 public class WriteArguments {
   public int displayNumber = Brlapi.DISPLAY_DEFAULT;
   public int regionBegin = 0;
@@ -26,6 +28,9 @@ public class WriteArguments {
   public String text = null;
   public byte andMask[] = null;
   public byte orMask[] = null;
+  /* direct buffers, used in place when the arrays above are null */
+  public ByteBuffer andMaskBuffer = null;
+  public ByteBuffer orMaskBuffer = null;
   public int cursor = Brlapi.CURSOR_LEAVE;
 
   public WriteArguments () {
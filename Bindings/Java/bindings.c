@@ -31,6 +31,7 @@
 #define ERR_NULLPTR 0
 #define ERR_OUTOFMEM 1
 #define ERR_INDEX 2
+#define ERR_ILLEGALARG 3
 
 /* TODO: threads */
 static JNIEnv *env;
@@ -43,6 +44,7 @@ static void ThrowException(JNIEnv *jenv, int code, const char *msg) {
     case ERR_NULLPTR:  exception = "java/lang/NullPointerException";      break;
     case ERR_OUTOFMEM: exception = "java/lang/OutOfMemoryError";          break;
     case ERR_INDEX:    exception = "java/lang/IndexOutOfBoundsException"; break;
+    case ERR_ILLEGALARG: exception = "java/lang/IllegalArgumentException"; break;
     default:           exception = "java/lang/UnknownError";              break;
   }
 
@@ -137,6 +139,34 @@ static void BRLAPI_STDCALL exceptionHandler(brlapi_handle_t *handle, int err, br
     return ret; \
   }
 
+/* Returns the address of the remaining bytes of a direct ByteBuffer, which
+ * are used in place, after checking that there are at least size of them */
+static unsigned char *getDirectBuffer(JNIEnv *jenv, jobject jbuffer, unsigned int size) {
+  unsigned char *address;
+  jclass jcbuffer;
+  jmethodID positionID, remainingID;
+  jint position, remaining;
+
+  if (!(address = (*jenv)->GetDirectBufferAddress(jenv, jbuffer))) {
+    ThrowException(jenv, ERR_ILLEGALARG, "not a direct buffer");
+    return NULL;
+  }
+  GET_CLASS(jenv, jcbuffer, jbuffer, NULL);
+  if (!(positionID = (*jenv)->GetMethodID(jenv, jcbuffer, "position", "()I")) ||
+      !(remainingID = (*jenv)->GetMethodID(jenv, jcbuffer, "remaining", "()I"))) {
+    ThrowException(jenv, ERR_NULLPTR, "getDirectBufferGetMethodID");
+    return NULL;
+  }
+  position = (*jenv)->CallIntMethod(jenv, jbuffer, positionID);
+  remaining = (*jenv)->CallIntMethod(jenv, jbuffer, remainingID);
+  if ((*jenv)->ExceptionCheck(jenv)) return NULL;
+  if (remaining < 0 || (unsigned int) remaining < size) {
+    ThrowException(jenv, ERR_INDEX, "buffer too small");
+    return NULL;
+  }
+  return address + position;
+}
+
 JNIEXPORT jint JNICALL Java_org_a11y_BrlAPI_Native_openConnection(JNIEnv *jenv, jobject jobj, jobject JclientSettings , jobject JusedSettings) {
   jclass jcclientSettings, jcusedSettings;
   jfieldID clientAuthID = NULL, clientHostID = NULL, usedAuthID, usedHostID;
@@ -418,13 +448,42 @@ JNIEXPORT void JNICALL Java_org_a11y_BrlAPI_Native_writeDots(JNIEnv *jenv, jobje
   }
 }
 
+JNIEXPORT void JNICALL Java_org_a11y_BrlAPI_Native_writeDotsNative(JNIEnv *jenv, jobject jobj, jobject jdots) {
+  unsigned int x, y;
+  unsigned char *dots;
+  int result;
+  GET_HANDLE(jenv, jobj, );
+
+  env = jenv;
+
+  if (!jdots) {
+    ThrowException(jenv, ERR_NULLPTR, __func__);
+    return;
+  }
+  if (brlapi__getDisplaySize(handle, &x, &y) < 0) {
+    ThrowError(jenv, __func__);
+    return;
+  }
+  if (!(dots = getDirectBuffer(jenv, jdots, x*y))) return;
+
+  result = brlapi__writeDots(handle, dots);
+
+  if (result < 0) {
+    ThrowError(jenv, __func__);
+    return;
+  }
+}
+
 JNIEXPORT void JNICALL Java_org_a11y_BrlAPI_Native_write(JNIEnv *jenv, jobject jobj, jobject jarguments) {
   brlapi_writeArguments_t arguments = BRLAPI_WRITEARGUMENTS_INITIALIZER;
   int result;
   jstring text, andMask, orMask;
+  jobject andMaskBuffer = NULL, orMaskBuffer = NULL;
+  unsigned int size = 0;
   jclass jcwriteArguments;
   jfieldID displayNumberID, regionBeginID, regionSizeID,
-	   textID, andMaskID, orMaskID, cursorID; 
+	   textID, andMaskID, orMaskID, cursorID,
+	   andMaskBufferID, orMaskBufferID;
   GET_HANDLE(jenv, jobj, );
 
   env = jenv;
@@ -443,21 +502,45 @@ JNIEXPORT void JNICALL Java_org_a11y_BrlAPI_Native_write(JNIEnv *jenv, jobject j
   GET_ID(jenv, andMaskID,      jcwriteArguments, "andMask",       "[B",);
   GET_ID(jenv, orMaskID,       jcwriteArguments, "orMask",        "[B",);
   GET_ID(jenv, cursorID,       jcwriteArguments, "cursor",        "I",);
+  GET_ID(jenv, andMaskBufferID,jcwriteArguments, "andMaskBuffer", "Ljava/nio/ByteBuffer;",);
+  GET_ID(jenv, orMaskBufferID, jcwriteArguments, "orMaskBuffer",  "Ljava/nio/ByteBuffer;",);
 
   arguments.displayNumber = (*jenv)->GetIntField(jenv, jarguments, displayNumberID);
   arguments.regionBegin   = (*jenv)->GetIntField(jenv, jarguments, regionBeginID);
   arguments.regionSize    = (*jenv)->GetIntField(jenv, jarguments, regionSizeID);
+
+  /* direct buffers are used in place, so check them before getting anything
+   * which would have to be released */
+  if (!(*jenv)->GetObjectField(jenv, jarguments, andMaskID))
+    andMaskBuffer = (*jenv)->GetObjectField(jenv, jarguments, andMaskBufferID);
+  if (!(*jenv)->GetObjectField(jenv, jarguments, orMaskID))
+    orMaskBuffer = (*jenv)->GetObjectField(jenv, jarguments, orMaskBufferID);
+  if (andMaskBuffer || orMaskBuffer) {
+    if (arguments.regionBegin || arguments.regionSize) {
+      size = arguments.regionSize;
+    } else {
+      unsigned int x, y;
+      if (brlapi__getDisplaySize(handle, &x, &y) < 0) {
+        ThrowError(jenv, __func__);
+        return;
+      }
+      size = x * y;
+    }
+  }
+  if (andMaskBuffer && !(arguments.andMask = getDirectBuffer(jenv, andMaskBuffer, size))) return;
+  if (orMaskBuffer && !(arguments.orMask = getDirectBuffer(jenv, orMaskBuffer, size))) return;
+
   if ((text  = (*jenv)->GetObjectField(jenv, jarguments, textID)))
     arguments.text   = (char *)(*jenv)->GetStringUTFChars(jenv, text, NULL);
   else 
     arguments.text  = NULL;
   if ((andMask = (*jenv)->GetObjectField(jenv, jarguments, andMaskID)))
     arguments.andMask  = (unsigned char *)(*jenv)->GetByteArrayElements(jenv, andMask, NULL);
-  else
+  else if (!andMaskBuffer)
     arguments.andMask = NULL;
   if ((orMask  = (*jenv)->GetObjectField(jenv, jarguments, orMaskID)))
     arguments.orMask   = (unsigned char *)(*jenv)->GetByteArrayElements(jenv, orMask, NULL);
-  else
+  else if (!orMaskBuffer)
     arguments.orMask  = NULL;
   arguments.cursor     = (*jenv)->GetIntField(jenv, jarguments, cursorID);
   arguments.charset = "UTF-8";
@@ -264,6 +264,18 @@ cdef class WriteStruct:
 			else:
 				self.props.orMask = NULL
 
+cdef int getBuffer(object val, c_brlapi.Py_buffer *view, Py_ssize_t size) except -1:
+	"""Get a view on val if it supports the buffer protocol (bytearray, memoryview, numpy arrays...), so that it can be used in place.
+	Returns 1 if the view was got, in which case it must be released, 0 if val doesn't support the buffer protocol.
+	Raises ValueError if it holds less than size bytes."""
+	if val is None or type(val) == unicode or not c_brlapi.PyObject_CheckBuffer(val):
+		return 0
+	c_brlapi.PyObject_GetBuffer(val, view, c_brlapi.PyBUF_SIMPLE)
+	if view.len < size:
+		c_brlapi.PyBuffer_Release(view)
+		raise ValueError("%d bytes given, %d needed" % (view.len, size))
+	return 1
+
 cdef class Connection:
 	"""Class which manages the bridge between your program and BrlAPI"""
 
@@ -457,8 +469,16 @@ cdef class Connection:
 			charset = None):
 		"""Update a specific region of the braille display and apply and/or masks.
 		See brlapi_write(3).
-		* s : gives information necessary for the update"""
+		* s : gives information necessary for the update
+
+		andMask and orMask may be objects supporting the buffer protocol (bytearray, memoryview, numpy arrays...), which are then used in place rather than copied. They must hold at least regionSize bytes."""
 		cdef int retval
+		cdef c_brlapi.brlapi_writeArguments_t props
+		cdef c_brlapi.Py_buffer andView
+		cdef c_brlapi.Py_buffer orView
+		cdef int andHeld = 0
+		cdef int orHeld = 0
+		cdef Py_ssize_t size = 0
 		if not writeArguments:
 			writeArguments = WriteStruct()
 		if displayNumber != None:
@@ -469,17 +489,37 @@ cdef class Connection:
 			writeArguments.regionSize = regionSize
 		if text:
 			writeArguments.text = text
-		if andMask:
-			writeArguments.attrAnd = andMask
-		if orMask:
-			writeArguments.attrOr = orMask
 		if cursor != None:
 			writeArguments.cursor = cursor
 		if charset:
 			writeArguments.charset = charset
-		c_brlapi.Py_BEGIN_ALLOW_THREADS
-		retval = c_brlapi.brlapi__write(self.h, &writeArguments.props)
-		c_brlapi.Py_END_ALLOW_THREADS
+		props = writeArguments.props
+		if props.regionBegin or props.regionSize:
+			size = props.regionSize
+		elif andMask is not None or orMask is not None:
+			(x, y) = self.displaySize
+			size = x * y
+		try:
+			andHeld = getBuffer(andMask, &andView, size)
+			if andHeld:
+				props.andMask = <unsigned char *>andView.buf
+			elif andMask:
+				writeArguments.attrAnd = andMask
+				props.andMask = writeArguments.props.andMask
+			orHeld = getBuffer(orMask, &orView, size)
+			if orHeld:
+				props.orMask = <unsigned char *>orView.buf
+			elif orMask:
+				writeArguments.attrOr = orMask
+				props.orMask = writeArguments.props.orMask
+			c_brlapi.Py_BEGIN_ALLOW_THREADS
+			retval = c_brlapi.brlapi__write(self.h, &props)
+			c_brlapi.Py_END_ALLOW_THREADS
+		finally:
+			if andHeld:
+				c_brlapi.PyBuffer_Release(&andView)
+			if orHeld:
+				c_brlapi.PyBuffer_Release(&orView)
 		if retval == -1:
 			raise OperationError()
 		else:
@@ -488,12 +528,28 @@ cdef class Connection:
 	def writeDots(self, dots):
 		"""Write the given dots array to the display.
 		See brlapi_writeDots(3).
-		* dots : points on an array of dot information, one per character. Its size must hence be the same as what displaysize provides."""
+		* dots : points on an array of dot information, one per character. Its size must hence be the same as what displaysize provides. Objects supporting the buffer protocol (bytearray, memoryview, numpy arrays...) which are that large are used in place rather than copied."""
 		cdef int retval
 		cdef char *c_dots
 		cdef unsigned char *c_udots
+		cdef c_brlapi.Py_buffer view
 		(x, y) = self.displaySize
 		dispSize = x * y
+		if (type(dots) != unicode and c_brlapi.PyObject_CheckBuffer(dots)):
+			c_brlapi.PyObject_GetBuffer(dots, &view, c_brlapi.PyBUF_SIMPLE)
+			if (view.len >= dispSize):
+				c_udots = <unsigned char *>view.buf
+				c_brlapi.Py_BEGIN_ALLOW_THREADS
+				retval = c_brlapi.brlapi__writeDots(self.h, c_udots)
+				c_brlapi.Py_END_ALLOW_THREADS
+				c_brlapi.PyBuffer_Release(&view)
+				if retval == -1:
+					raise OperationError()
+				else:
+					return retval
+			c_dots = <char *>view.buf
+			dots = c_dots[:view.len]
+			c_brlapi.PyBuffer_Release(&view)
 		if (type(dots) == unicode):
 			dots = dots.encode('latin1')
 		if (len(dots) < dispSize):
@@ -119,3 +119,12 @@ cdef extern from "Python.h":
 	# these are macros, we just need to make Cython aware of them
 	int Py_BEGIN_ALLOW_THREADS
 	int Py_END_ALLOW_THREADS
+
+	# buffer protocol, for using masks in place
+	ctypedef struct Py_buffer:
+		void *buf
+		Py_ssize_t len
+	int PyBUF_SIMPLE
+	int PyObject_CheckBuffer(object)
+	int PyObject_GetBuffer(object, Py_buffer *, int) except -1
+	void PyBuffer_Release(Py_buffer *)
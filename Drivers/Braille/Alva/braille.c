@@ -463,6 +463,7 @@ typedef struct {
   int (*detectModel) (BrailleDisplay *brl);
   int (*readCommand) (BrailleDisplay *brl);
   int (*writeBraille) (BrailleDisplay *brl, const unsigned char *cells, int start, int count);
+  BrailleUpdateModel updateModel;
 } ProtocolOperations;
 static const ProtocolOperations *protocol;
 
@@ -955,7 +956,8 @@ writeBraille1 (BrailleDisplay *brl, const unsigned char *cells, int start, int c
 static const ProtocolOperations protocol1Operations = {
   initializeVariables1,
   readPacket1, updateConfiguration1, detectModel1,
-  readCommand1, writeBraille1
+  readCommand1, writeBraille1,
+  {.rangeOverhead = 6}
 };
 
 static uint32_t firmwareVersion2;
@@ -1284,7 +1286,8 @@ writeBraille2s (BrailleDisplay *brl, const unsigned char *cells, int start, int
 static const ProtocolOperations protocol2sOperations = {
   initializeVariables2,
   readPacket2s, updateConfiguration2s, detectModel2s,
-  readCommand2s, writeBraille2s
+  readCommand2s, writeBraille2s,
+  {.rangeOverhead = 4}
 };
 
 static int
@@ -1458,7 +1461,8 @@ writeBraille2u (BrailleDisplay *brl, const unsigned char *cells, int start, int
 static const ProtocolOperations protocol2uOperations = {
   initializeVariables2,
   readPacket2u, updateConfiguration2u, detectModel2u,
-  readCommand2u, writeBraille2u
+  readCommand2u, writeBraille2u,
+  {.rangeOverhead = 3}
 };
 
 #include "io_serial.h"
@@ -1751,10 +1755,20 @@ brl_destruct (BrailleDisplay *brl) {
 }
 
 static int
-brl_writeWindow (BrailleDisplay *brl, const wchar_t *text) {
-  unsigned int from;
-  unsigned int to;
+writeTextRange (
+  BrailleDisplay *brl,
+  const unsigned char *cells, unsigned int from, unsigned int to,
+  void *data
+) {
+  size_t count = to - from;
+  unsigned char buffer[count];
+
+  translateOutputCells(buffer, &cells[from], count);
+  return protocol->writeBraille(brl, buffer, textOffset+from, count);
+}
 
+static int
+brl_writeWindow (BrailleDisplay *brl, const wchar_t *text) {
   if (textRewriteInterval) {
     TimeValue now;
     getMonotonicTime(&now);
@@ -1762,15 +1776,9 @@ brl_writeWindow (BrailleDisplay *brl, const wchar_t *text) {
     if (textRewriteRequired) textRewriteTime = now;
   }
 
-  if (cellsHaveChanged(previousText, brl->buffer, brl->textColumns, &from, &to, &textRewriteRequired)) {
-    size_t count = to - from;
-    unsigned char cells[count];
-
-    translateOutputCells(cells, &brl->buffer[from], count);
-    if (!protocol->writeBraille(brl, cells, textOffset+from, count)) return 0;
-  }
-
-  return 1;
+  return writeChangedCells(brl, previousText, brl->buffer, brl->textColumns,
+                           &textRewriteRequired, &protocol->updateModel,
+                           writeTextRange, NULL);
 }
 
 static int
@@ -2376,140 +2376,160 @@ openUsbPort (const char *device) {
       .vendor=0X0403, .product=0XFE70,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* PocketVario (24 cells) */
       .vendor=0X0403, .product=0XFE71,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* SuperVario 40 (40 cells) */
       .vendor=0X0403, .product=0XFE72,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* SuperVario 32 (32 cells) */
       .vendor=0X0403, .product=0XFE73,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* SuperVario 64 (64 cells) */
       .vendor=0X0403, .product=0XFE74,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* SuperVario 80 (80 cells) */
       .vendor=0X0403, .product=0XFE75,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioPro 80 (80 cells) */
       .vendor=0X0403, .product=0XFE76,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioPro 64 (64 cells) */
       .vendor=0X0403, .product=0XFE77,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioPro 40 (40 cells) */
       .vendor=0X0904, .product=0X2000,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* EcoVario 24 (24 cells) */
       .vendor=0X0904, .product=0X2001,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* EcoVario 40 (40 cells) */
       .vendor=0X0904, .product=0X2002,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioConnect 40 (40 cells) */
       .vendor=0X0904, .product=0X2007,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioConnect 32 (32 cells) */
       .vendor=0X0904, .product=0X2008,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioConnect 24 (24 cells) */
       .vendor=0X0904, .product=0X2009,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioConnect 64 (64 cells) */
       .vendor=0X0904, .product=0X2010,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* VarioConnect 80 (80 cells) */
       .vendor=0X0904, .product=0X2011,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* EcoVario 32 (32 cells) */
       .vendor=0X0904, .product=0X2014,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* EcoVario 64 (64 cells) */
       .vendor=0X0904, .product=0X2015,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* EcoVario 80 (80 cells) */
       .vendor=0X0904, .product=0X2016,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { /* Refreshabraille 18 (18 cells) */
       .vendor=0X0904, .product=0X3000,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .disableAutosuspend=1
+      .disableAutosuspend=1,
+      .lowLatency=1
     }
     ,
     { .vendor=0 }
@@ -523,17 +523,12 @@ updateCells (
   }
 }
 
-typedef struct {
-  unsigned char checksum;
-} ReadPacketData;
-
 static int
 verifyPacket (
   BrailleDisplay *brl,
   const unsigned char *bytes, size_t size,
   size_t *length, void *data
 ) {
-  ReadPacketData *rpd = data;
   unsigned char byte = bytes[size-1];
 
   switch (size) {
@@ -552,8 +547,6 @@ verifyPacket (
         default:
           return 0;
       }
-
-      rpd->checksum = 0;
       break;
 
     case 2:
@@ -564,20 +557,26 @@ verifyPacket (
       break;
   }
 
-  rpd->checksum -= byte;
-  if ((size == *length) && (size > sizeof(PacketHeader)) && rpd->checksum) return 0;
+  if ((size == *length) && (size > sizeof(PacketHeader))) {
+    unsigned char checksum = 0;
+    const unsigned char *end = bytes + size;
+
+    while (bytes < end) checksum -= *bytes++;
+    if (checksum) return 0;
+  }
 
   brl->data->acknowledgementsMissing = 0;
-  return 1;
+
+  /* the length is known once the header is complete */
+  if (size == sizeof(PacketHeader)) return BRL_PVR_FRAMED;
+  return BRL_PVR_INCLUDE;
 }
 
 static int
 readPacket (BrailleDisplay *brl, Packet *packet) {
-  ReadPacketData rpd;
-
   return readBraillePacket(brl, brl->data->gioEndpoint,
                            packet, sizeof(*packet),
-                           verifyPacket, &rpd);
+                           verifyPacket, NULL);
 }
 
 static int
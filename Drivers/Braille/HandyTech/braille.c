@@ -834,6 +834,7 @@ openUsbPort (char **parameters, const char *device) {
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
       .serial = &serial,
+      .lowLatency=1,
       .data=&usbOperations1
     }
     ,
@@ -87,13 +87,13 @@ verifyPacket (
 
     case 3:
       *length += byte;
-      break;
+      return BRL_PVR_FRAMED;
 
     default:
       break;
   }
 
-  return 1;
+  return BRL_PVR_INCLUDE;
 }
 
 static int
@@ -164,6 +164,51 @@ isIdentityResponse (BrailleDisplay *brl, const void *packet, size_t size) {
   return (response->fields.type == HW_MSG_INIT_RESP)? BRL_RSP_DONE: BRL_RSP_UNEXPECTED;
 }
 
+static void
+handleKeyEvent (unsigned char key, int press) {
+  unsigned char set;
+
+  if (key < HW_KEY_ROUTING) {
+    set = HW_SET_NavigationKeys;
+  } else {
+    set = HW_SET_RoutingKeys;
+    key -= HW_KEY_ROUTING;
+  }
+
+  enqueueKeyEvent(set, key, press);
+}
+
+static int
+processInputPackets (BrailleDisplay *brl) {
+  HW_Packet packet;
+  size_t length;
+
+  while ((length = readBraillePacket(brl, brl->data->gioEndpoint, &packet, sizeof(packet), verifyPacket, NULL))) {
+    switch (packet.fields.type) {
+      case HW_MSG_KEY_DOWN:
+        handleKeyEvent(packet.fields.data.key.id, 1);
+        continue;
+
+      case HW_MSG_KEY_UP:
+        handleKeyEvent(packet.fields.data.key.id, 0);
+        continue;
+
+      default:
+        break;
+    }
+
+    logUnexpectedPacket(&packet, length);
+  }
+
+  return errno == EAGAIN;
+}
+
+static int
+handleInput (const AsyncMonitorResult *result) {
+  /* on error, stop - the next brl_readCommand will see it too */
+  return processInputPackets(result->data);
+}
+
 static int
 brl_construct (BrailleDisplay *brl, char **parameters, const char *device) {
   if ((brl->data = malloc(sizeof(*brl->data)))) {
@@ -195,6 +240,9 @@ brl_construct (BrailleDisplay *brl, char **parameters, const char *device) {
 
           makeOutputTable(dotsTable_ISO11548_1);
           brl->data->forceWrite = 1;
+
+          /* key events are still read by brl_readCommand if this fails */
+          gioMonitorInput(brl->data->gioEndpoint, handleInput, brl);
           return 1;
         }
       }
@@ -237,41 +285,7 @@ brl_writeWindow (BrailleDisplay *brl, const wchar_t *text) {
   return 1;
 }
 
-static void
-handleKeyEvent (unsigned char key, int press) {
-  unsigned char set;
-
-  if (key < HW_KEY_ROUTING) {
-    set = HW_SET_NavigationKeys;
-  } else {
-    set = HW_SET_RoutingKeys;
-    key -= HW_KEY_ROUTING;
-  }
-
-  enqueueKeyEvent(set, key, press);
-}
-
 static int
 brl_readCommand (BrailleDisplay *brl, KeyTableCommandContext context) {
-  HW_Packet packet;
-  size_t length;
-
-  while ((length = readBraillePacket(brl, brl->data->gioEndpoint, &packet, sizeof(packet), verifyPacket, NULL))) {
-    switch (packet.fields.type) {
-      case HW_MSG_KEY_DOWN:
-        handleKeyEvent(packet.fields.data.key.id, 1);
-        continue;
-
-      case HW_MSG_KEY_UP:
-        handleKeyEvent(packet.fields.data.key.id, 0);
-        continue;
-
-      default:
-        break;
-    }
-
-    logUnexpectedPacket(&packet, length);
-  }
-
-  return (errno == EAGAIN)? EOF: BRL_CMD_RESTARTBRL;
+  return processInputPackets(brl)? EOF: BRL_CMD_RESTARTBRL;
 }
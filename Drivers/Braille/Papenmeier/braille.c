@@ -1110,7 +1110,8 @@ connectResource (const char *identifier) {
       .vendor=0X0403, .product=0XF208,
       .configuration=1, .interface=0, .alternative=0,
       .inputEndpoint=1, .outputEndpoint=2,
-      .serial = &serialParameters
+      .serial = &serialParameters,
+      .lowLatency=1
     }
     ,
     { .vendor=0 }
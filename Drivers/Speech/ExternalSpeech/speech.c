@@ -45,6 +45,14 @@
 #include "log.h"
 #include "timing.h"
 
+#ifndef __MINGW32__
+#include "async.h"
+#include "queue.h"
+
+#define HELPER_INPUT_SIZE 0X100
+#define HELPER_OUTPUT_LIMIT 0X10000
+#endif /* __MINGW32__ */
+
 typedef enum {
   PARM_PROGRAM=0,
   PARM_UID, PARM_GID
@@ -60,6 +68,24 @@ static int helper_fd_in = -1, helper_fd_out = -1;
 static unsigned short lastIndex, finalIndex;
 static char speaking = 0;
 
+#ifndef __MINGW32__
+/* Packets are written to the helper one at a time, and are held here until
+ * the previous one has been completely written, so that a slow helper can't
+ * block the main loop and so that text which hasn't been sent yet can still
+ * be discarded.
+ */
+typedef struct {
+  unsigned char isText;
+  size_t size;
+  unsigned char bytes[0];
+} OutputPacket;
+
+static Queue *outputQueue = NULL;
+static size_t outputQueued = 0;
+static AsyncHandle outputHandle = NULL;
+static AsyncHandle inputHandle = NULL;
+#endif /* __MINGW32__ */
+
 #define ERRBUFLEN 200
 static void myerror(SpeechSynthesizer *spk, char *fmt, ...)
 {
@@ -94,6 +120,102 @@ static void myperror(SpeechSynthesizer *spk, char *fmt, ...)
   spk_destruct(spk);
 }
 
+static void receiveIndex(SpeechSynthesizer *spk, unsigned inx)
+{
+  logMessage(LOG_DEBUG, "spktrk: Received index %u", inx);
+  if(inx >= finalIndex) {
+    speaking = 0;
+    logMessage(LOG_DEBUG, "spktrk: Done speaking %d", lastIndex);
+    /* do not change last_inx: remain on position of last spoken words,
+       not after them. */
+  }else lastIndex = inx;
+}
+
+#ifndef __MINGW32__
+static size_t handleHelperInput(const AsyncInputResult *result)
+{
+  SpeechSynthesizer *spk = result->data;
+  const unsigned char *b = result->buffer;
+  size_t length = result->length;
+
+  if(result->error) {
+    errno = result->error;
+    asyncDiscardHandle(inputHandle);
+    inputHandle = NULL;
+    myperror(spk, "pipe to helper program: read");
+    return 0;
+  }
+
+  while(length >= 2) {
+    receiveIndex(spk, b[0]<<8 | b[1]);
+    b += 2; length -= 2;
+  }
+
+  if(result->end) {
+    asyncDiscardHandle(inputHandle);
+    inputHandle = NULL;
+    myerror(spk, "pipe to helper program: read: EOF!");
+    return 0;
+  }
+
+  return result->length - length;
+}
+
+static void deallocateOutputPacket(void *item, void *data)
+{
+  OutputPacket *packet = item;
+  outputQueued -= packet->size;
+  free(packet);
+}
+
+static int testTextPacket(const void *item, const void *data)
+{
+  const OutputPacket *packet = item;
+  return packet->isText && (packet != data);
+}
+
+static void discardText(const OutputPacket *keep)
+{
+  Element *element;
+  while((element = findElement(outputQueue, testTextPacket, keep)))
+    deleteElement(element);
+}
+
+static void startOutput(SpeechSynthesizer *spk);
+
+static void handleHelperOutput(const AsyncOutputResult *result)
+{
+  SpeechSynthesizer *spk = result->data;
+
+  asyncDiscardHandle(outputHandle);
+  outputHandle = NULL;
+
+  if(result->error) {
+    errno = result->error;
+    if(errno == EPIPE)
+      myerror(spk, "pipe to helper program was broken");
+    else myperror(spk, "pipe to helper program: write");
+    return;
+  }
+
+  startOutput(spk);
+}
+
+static void startOutput(SpeechSynthesizer *spk)
+{
+  OutputPacket *packet;
+  if(outputHandle || helper_fd_out < 0) return;
+  if(!(packet = dequeueItem(outputQueue))) return;
+  outputQueued -= packet->size;
+  if(!asyncWriteFile(&outputHandle, helper_fd_out, packet->bytes, packet->size,
+                     handleHelperOutput, spk)) {
+    outputHandle = NULL;
+    myerror(spk, "pipe to helper program: cannot queue write");
+  }
+  free(packet);
+}
+#endif /* __MINGW32__ */
+
 static int spk_construct (SpeechSynthesizer *spk, char **parameters)
 {
   char *extProgPath = parameters[PARM_PROGRAM];
@@ -226,6 +348,17 @@ static int spk_construct (SpeechSynthesizer *spk, char **parameters)
       return 0;
     }
   };
+
+  if(!(outputQueue = newQueue(deallocateOutputPacket, NULL))) {
+    myerror(spk, "cannot allocate output queue");
+    return 0;
+  }
+  if(!asyncReadFile(&inputHandle, helper_fd_in, HELPER_INPUT_SIZE,
+                    handleHelperInput, spk)) {
+    inputHandle = NULL;
+    myerror(spk, "cannot monitor pipe from helper program");
+    return 0;
+  }
 #endif /* __MINGW32__ */
 
   logMessage(LOG_INFO,"Opened pipe to external speech program '%s'",
@@ -234,6 +367,7 @@ static int spk_construct (SpeechSynthesizer *spk, char **parameters)
   return 1;
 }
 
+#ifdef __MINGW32__
 static void mywrite(SpeechSynthesizer *spk, int fd, const void *buf, int len)
 {
   char *pos = (char *)buf;
@@ -283,10 +417,45 @@ static int myread(SpeechSynthesizer *spk, int fd, void *buf, int len)
   }
   return 1;
 }
+#endif /* __MINGW32__ */
+
+static void sendPacket(SpeechSynthesizer *spk, const void *buf, size_t len, int isText)
+{
+#ifdef __MINGW32__
+  mywrite(spk, helper_fd_out, buf, len);
+#else /* __MINGW32__ */
+  OutputPacket *packet;
+  if(helper_fd_out < 0) return;
+  if(!(packet = malloc(sizeof(*packet) + len))) {
+    logMallocError();
+    return;
+  }
+  packet->isText = isText;
+  packet->size = len;
+  memcpy(packet->bytes, buf, len);
+  if(!enqueueItem(outputQueue, packet)) {
+    free(packet);
+    return;
+  }
+  outputQueued += len;
+
+  if(outputQueued > HELPER_OUTPUT_LIMIT) {
+    /* the helper isn't keeping up: drop the oldest text it hasn't been sent */
+    Element *element;
+    while(outputQueued > HELPER_OUTPUT_LIMIT
+          && (element = findElement(outputQueue, testTextPacket, packet))) {
+      logMessage(LOG_DEBUG, "discarding unsent text");
+      deleteElement(element);
+    }
+  }
+
+  startOutput(spk);
+#endif /* __MINGW32__ */
+}
 
 static void spk_say(SpeechSynthesizer *spk, const unsigned char *text, size_t length, size_t count, const unsigned char *attributes)
 {
-  unsigned char l[5];
+  unsigned char l[5 + length + (attributes? count: 0)];
   if(helper_fd_out < 0) return;
   l[0] = 4; /* say code */
   l[1] = length >> 8;
@@ -298,29 +467,22 @@ static void spk_say(SpeechSynthesizer *spk, const unsigned char *text, size_t le
     l[3] = 0;
     l[4] = 0;
   }
+  memcpy(&l[5], text, length);
+  if (attributes) memcpy(&l[5+length], attributes, count);
   speaking = 1;
-  mywrite(spk, helper_fd_out, l, 5);
-  mywrite(spk, helper_fd_out, text, length);
-  if (attributes) mywrite(spk, helper_fd_out, attributes, count);
   lastIndex = 0;
   finalIndex = count;
+  sendPacket(spk, l, sizeof(l), 1);
 }
 
 static void spk_doTrack(SpeechSynthesizer *spk)
 {
+#ifdef __MINGW32__
   unsigned char b[2];
   if(helper_fd_in < 0) return;
-  while(myread(spk, helper_fd_in, b, 2)) {
-    unsigned inx;
-    inx = (b[0]<<8 | b[1]);
-    logMessage(LOG_DEBUG, "spktrk: Received index %u", inx);
-    if(inx >= finalIndex) {
-      speaking = 0;
-      logMessage(LOG_DEBUG, "spktrk: Done speaking %d", lastIndex);
-	/* do not change last_inx: remain on position of last spoken words,
-	   not after them. */
-    }else lastIndex = inx;
-  }
+  while(myread(spk, helper_fd_in, b, 2))
+    receiveIndex(spk, b[0]<<8 | b[1]);
+#endif /* __MINGW32__ */
 }
 
 static int spk_getTrack(SpeechSynthesizer *spk)
@@ -339,7 +501,10 @@ static void spk_mute (SpeechSynthesizer *spk)
   if(helper_fd_out < 0) return;
   logMessage(LOG_DEBUG,"mute");
   speaking = 0;
-  mywrite(spk, helper_fd_out, &c,1);
+#ifndef __MINGW32__
+  discardText(NULL);
+#endif /* __MINGW32__ */
+  sendPacket(spk, &c, 1, 0);
 }
 
 static void spk_setRate (SpeechSynthesizer *spk, unsigned char setting)
@@ -355,11 +520,25 @@ static void spk_setRate (SpeechSynthesizer *spk, unsigned char setting)
 #else /* WORDS_BIGENDIAN */
   l[1] = p[3]; l[2] = p[2]; l[3] = p[1]; l[4] = p[0];
 #endif /* WORDS_BIGENDIAN */
-  mywrite(spk, helper_fd_out, &l, 5);
+  sendPacket(spk, l, 5, 0);
 }
 
 static void spk_destruct (SpeechSynthesizer *spk)
 {
+#ifndef __MINGW32__
+  if(inputHandle) {
+    asyncCancelRequest(inputHandle);
+    inputHandle = NULL;
+  }
+  if(outputHandle) {
+    asyncCancelRequest(outputHandle);
+    outputHandle = NULL;
+  }
+  if(outputQueue) {
+    deallocateQueue(outputQueue);
+    outputQueue = NULL;
+  }
+#endif /* __MINGW32__ */
   if(helper_fd_in >= 0)
     close(helper_fd_in);
   if(helper_fd_out >= 0)
@@ -61,25 +61,109 @@ static pthread_mutex_t queue_lock;
 static pthread_cond_t queue_cond;
 static volatile int alive;
 
+/*
+ * Requests are kept back to back in a fixed-size ring, so queueing one needs
+ * neither a malloc nor a walk to the end of a list. Each one is contiguous
+ * (a padding entry skips the end of the ring when it wouldn't fit there) so
+ * that its text can be handed to espeak_Synth() where it is.
+ *
+ * queue_tail: the request being spoken (free space ends here)
+ * queue_next: the oldest request not yet taken by the request thread
+ * queue_head: where the next request is written
+ */
+#define QUEUE_SIZE 0X10000
+#define QUEUE_ALIGNMENT sizeof(struct request)
+
 struct request {
-	struct request *next;
-	unsigned buflength;
-	unsigned char buffer[0];
+	unsigned int length; /* of the text, including the trailing zero */
+	unsigned int size;   /* of the whole entry, 0 for padding */
 };
 
-static struct request *request_queue;
+static unsigned char queue_buffer[QUEUE_SIZE];
+static size_t queue_tail, queue_next, queue_head;
+static int queue_cancel;
+
+static void clear_queue(void)
+{
+	queue_tail = queue_next = queue_head = 0;
+	queue_cancel = 0;
+}
+
+static struct request *queue_entry(size_t offset)
+{
+	return (struct request *)&queue_buffer[offset];
+}
 
-static void free_queue(void)
+static size_t entry_size(size_t length)
 {
-	struct request *curr = request_queue;
-	request_queue = NULL;
-	while (curr) {
-		struct request *next = curr->next;
-		free(curr);
-		curr = next;
+	size_t size = sizeof(struct request) + length;
+	return (size + QUEUE_ALIGNMENT - 1) / QUEUE_ALIGNMENT * QUEUE_ALIGNMENT;
+}
+
+/* how much can be written at the head without wrapping, and after wrapping */
+static void queue_space(size_t *here, size_t *wrapped)
+{
+	if (queue_tail == queue_head) {
+		/* nothing is in use so start again at the beginning */
+		queue_tail = queue_next = queue_head = 0;
+		*here = QUEUE_SIZE - QUEUE_ALIGNMENT;
+		*wrapped = 0;
+	} else if (queue_head > queue_tail) {
+		*here = QUEUE_SIZE - queue_head;
+		if (!queue_tail) *here -= QUEUE_ALIGNMENT;
+		*wrapped = queue_tail? queue_tail - QUEUE_ALIGNMENT: 0;
+	} else {
+		*here = queue_tail - queue_head - QUEUE_ALIGNMENT;
+		*wrapped = 0;
+	}
+}
+
+static void enqueue_request(const unsigned char *text, size_t length)
+{
+	size_t size, here, wrapped;
+
+	size = entry_size(length + 1);
+	queue_space(&here, &wrapped);
+
+	if (size > here && size > wrapped && queue_next != queue_head) {
+		/* speech has fallen too far behind, so drop what hasn't been started */
+		logMessage(LOG_DEBUG, "eSpeak: queue full - discarding unspoken requests");
+		queue_head = queue_next;
+		queue_space(&here, &wrapped);
+	}
+
+	if (size > here && size > wrapped) {
+		size_t space = (here > wrapped)? here: wrapped;
+		if (space <= sizeof(struct request)) {
+			logMessage(LOG_WARNING, "eSpeak: no room for request");
+			return;
+		}
+
+		/* truncate the text on a UTF-8 character boundary */
+		length = space - sizeof(struct request) - 1;
+		while (length && (text[length] & 0XC0) == 0X80)
+			length -= 1;
+		size = entry_size(length + 1);
 	}
+
+	if (size > here) {
+		queue_entry(queue_head)->size = 0;
+		queue_head = 0;
+	}
+
+	{
+		struct request *new = queue_entry(queue_head);
+		unsigned char *buffer = (unsigned char *)(new + 1);
+
+		new->length = length + 1;
+		new->size = size;
+		memcpy(buffer, text, length);
+		buffer[length] = 0;
+	}
+
+	queue_head = (queue_head + size) % QUEUE_SIZE;
 }
-	
+
 static void *process_request(void *unused)
 {
 	struct request *curr;
@@ -87,23 +171,35 @@ static void *process_request(void *unused)
 
 	pthread_mutex_lock(&queue_lock);
 	while (alive) {
-		curr = request_queue;
-		if (!curr) {
+		if (queue_cancel) {
+			queue_cancel = 0;
+			pthread_mutex_unlock(&queue_lock);
+			espeak_Cancel();
+			pthread_mutex_lock(&queue_lock);
+			continue;
+		}
+
+		if (queue_next == queue_head) {
+			/* what was taken last has been spoken */
+			queue_tail = queue_next;
 			pthread_cond_wait(&queue_cond, &queue_lock);
 			continue;
 		}
-		request_queue = curr->next;
+
+		if (!queue_entry(queue_next)->size)
+			queue_next = 0;
+
+		queue_tail = queue_next;
+		curr = queue_entry(queue_next);
+		queue_next = (queue_next + curr->size) % QUEUE_SIZE;
 		pthread_mutex_unlock(&queue_lock);
-		if (curr->buflength) {
-			result = espeak_Synth(curr->buffer, curr->buflength, 0,
-					POS_CHARACTER, 0, espeakCHARS_UTF8,
-					NULL, NULL);
-			if (result != EE_OK)
-				logMessage(LOG_ERR, "eSpeak: Synth() returned error %d", result);
-		} else {
-			espeak_Cancel();
-		}
-		free(curr);
+
+		result = espeak_Synth(curr + 1, curr->length, 0,
+				POS_CHARACTER, 0, espeakCHARS_UTF8,
+				NULL, NULL);
+		if (result != EE_OK)
+			logMessage(LOG_ERR, "eSpeak: Synth() returned error %d", result);
+
 		pthread_mutex_lock(&queue_lock);
 	}
 	pthread_mutex_unlock(&queue_lock);
@@ -117,28 +213,13 @@ static void
 spk_say(SpeechSynthesizer *spk, const unsigned char *buffer, size_t length, size_t count, const unsigned char *attributes)
 {
 #ifdef HAVE_POSIX_THREADS
-	struct request *new, **prev_next;
-
 	IndexPos = 0;
 
 	if (!length)
 		return;
 
-	new = malloc(sizeof(*new) + length + 1);
-	if (!new) {
-		logSystemError("eSpeak: malloc");
-		return;
-	}
-	new->next = NULL;
-	new->buflength = length + 1;
-	memcpy(new->buffer, buffer, length);
-	new->buffer[length] = 0;
-
 	pthread_mutex_lock(&queue_lock);
-	prev_next = &request_queue;
-	while (*prev_next)
-		prev_next = &(*prev_next)->next;
-	*prev_next = new;
+	enqueue_request(buffer, length);
 	pthread_cond_signal(&queue_cond);
 	pthread_mutex_unlock(&queue_lock);
 #else /* HAVE_POSIX_THREADS */
@@ -158,16 +239,10 @@ static void
 spk_mute(SpeechSynthesizer *spk)
 {
 #ifdef HAVE_POSIX_THREADS
-	struct request *stop = malloc(sizeof(*stop));
-	if (!stop) {
-		logSystemError("eSpeak: malloc");
-		return;
-	}
-	stop->next = NULL;
-	stop->buflength = 0;
+	/* requests which haven't been started are discarded right away */
 	pthread_mutex_lock(&queue_lock);
-	free_queue();
-	request_queue = stop;
+	queue_head = queue_next;
+	queue_cancel = 1;
 	pthread_cond_signal(&queue_cond);
 	pthread_mutex_unlock(&queue_lock);
 #else /* HAVE_POSIX_THREADS */
@@ -287,6 +362,7 @@ static int spk_construct(SpeechSynthesizer *spk, char **parameters)
 
 	pthread_mutex_init(&queue_lock, NULL);
 	pthread_cond_init(&queue_cond, NULL);
+	clear_queue();
 
 	alive = 1;
 	result = pthread_create(&request_thread, NULL, process_request, NULL);
@@ -313,7 +389,7 @@ static void spk_destruct(SpeechSynthesizer *spk)
 	pthread_join(request_thread, NULL);
 	pthread_mutex_destroy(&queue_lock);
 	pthread_cond_destroy(&queue_cond);
-	free_queue();
+	clear_queue();
 #endif /* HAVE_POSIX_THREADS */
 
 	espeak_Cancel();
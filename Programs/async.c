@@ -338,7 +338,10 @@ initializeMonitor (MonitorEntry *monitor, const FunctionEntry *function, const O
 
 static int
 testMonitor (const MonitorEntry *monitor, const FunctionEntry *function) {
-  return (monitor->revents & function->pollEvents) != 0;
+  /* a hangup or an error is reported by poll() even though it wasn't asked
+   * for, and the next read or write needs to be done in order to see it
+   */
+  return (monitor->revents & (function->pollEvents | POLLHUP | POLLERR)) != 0;
 }
 
 static void
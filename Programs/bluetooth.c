@@ -33,12 +33,55 @@ typedef struct {
   uint64_t bda;
   int connectError;
   char *deviceName;
+
+  struct {
+    uint8_t channel;
+    int delay;
+    AsyncHandle alarm;
+    AsyncHandle monitor;
+    BluetoothConnectionExtension *pending;
+    BluetoothConnectionExtension *ready;
+  } reconnect;
 } BluetoothDeviceEntry;
 
+#define BLUETOOTH_RECONNECT_INITIAL_DELAY 1000
+#define BLUETOOTH_RECONNECT_MAXIMUM_DELAY 60000
+
+static void
+bthStopReconnect (BluetoothDeviceEntry *entry) {
+  if (entry->reconnect.alarm) {
+    asyncCancelRequest(entry->reconnect.alarm);
+    entry->reconnect.alarm = NULL;
+  }
+
+  if (entry->reconnect.monitor) {
+    asyncCancelRequest(entry->reconnect.monitor);
+    entry->reconnect.monitor = NULL;
+  }
+
+  if (entry->reconnect.pending) {
+    bthDisconnect(entry->reconnect.pending);
+    entry->reconnect.pending = NULL;
+  }
+
+  if (entry->reconnect.ready) {
+    bthDisconnect(entry->reconnect.ready);
+    entry->reconnect.ready = NULL;
+  }
+
+  entry->reconnect.delay = 0;
+}
+
+static int
+bthIsReconnecting (const BluetoothDeviceEntry *entry) {
+  return entry->reconnect.alarm || entry->reconnect.pending || entry->reconnect.ready;
+}
+
 static void
 bthDeallocateDeviceEntry (void *item, void *data) {
   BluetoothDeviceEntry *entry = item;
 
+  bthStopReconnect(entry);
   if (entry->deviceName) free(entry->deviceName);
   free(entry);
 }
@@ -70,6 +113,7 @@ bthGetDeviceEntry (uint64_t bda, int add) {
 
     if (add) {
       if ((entry = malloc(sizeof(*entry)))) {
+        memset(entry, 0, sizeof(*entry));
         entry->bda = bda;
         entry->connectError = 0;
         entry->deviceName = NULL;
@@ -85,9 +129,25 @@ bthGetDeviceEntry (uint64_t bda, int add) {
   return NULL;
 }
 
+static int
+bthTestIdleDeviceEntry (const void *item, const void *data) {
+  const BluetoothDeviceEntry *entry = item;
+
+  return !bthIsReconnecting(entry);
+}
+
 void
 bthClearCache (void) {
-  if (bthInitializeDeviceQueue()) deleteElements(bluetoothDeviceQueue);
+  if (bthInitializeDeviceQueue()) {
+    Element *element;
+
+    /* Devices being reconnected in the background are kept so that a
+     * driver restart picks up their connection as soon as it's ready.
+     */
+    while ((element = findElement(bluetoothDeviceQueue, bthTestIdleDeviceEntry, NULL))) {
+      deleteElement(element);
+    }
+  }
 }
 
 static int
@@ -115,6 +175,115 @@ bthForgetConnectError (uint64_t bda) {
   if (entry) entry->connectError = 0;
 }
 
+static void bthScheduleReconnect (BluetoothDeviceEntry *entry);
+
+static int
+bthHandleReconnectMonitor (const AsyncMonitorResult *result) {
+  BluetoothDeviceEntry *entry = result->data;
+  BluetoothConnectionExtension *bcx = entry->reconnect.pending;
+
+  asyncDiscardHandle(entry->reconnect.monitor);
+  entry->reconnect.monitor = NULL;
+  entry->reconnect.pending = NULL;
+
+  if (bthFinishConnect(bcx)) {
+    logMessage(LOG_DEBUG, "Bluetooth reconnected: %012llX channel %u",
+               (unsigned long long)entry->bda, entry->reconnect.channel);
+    entry->reconnect.ready = bcx;
+    entry->reconnect.delay = 0;
+    entry->connectError = 0;
+  } else {
+    entry->connectError = errno;
+    bthDisconnect(bcx);
+    bthScheduleReconnect(entry);
+  }
+
+  return 0;
+}
+
+static void
+bthHandleReconnectAlarm (const AsyncAlarmResult *result) {
+  BluetoothDeviceEntry *entry = result->data;
+  BluetoothConnectionExtension *bcx;
+
+  asyncDiscardHandle(entry->reconnect.alarm);
+  entry->reconnect.alarm = NULL;
+
+  if ((bcx = bthStartConnect(entry->bda, entry->reconnect.channel))) {
+    entry->reconnect.pending = bcx;
+
+    if (bthMonitorConnect(bcx, &entry->reconnect.monitor,
+                          bthHandleReconnectMonitor, entry)) {
+      return;
+    }
+
+    entry->reconnect.monitor = NULL;
+    entry->reconnect.pending = NULL;
+    bthDisconnect(bcx);
+  } else if (errno == ENOSYS) {
+    entry->reconnect.delay = 0;
+    return;
+  }
+
+  bthScheduleReconnect(entry);
+}
+
+static void
+bthScheduleReconnect (BluetoothDeviceEntry *entry) {
+  int delay = entry->reconnect.delay;
+
+  if (!delay) {
+    delay = BLUETOOTH_RECONNECT_INITIAL_DELAY;
+  } else if ((delay *= 2) > BLUETOOTH_RECONNECT_MAXIMUM_DELAY) {
+    delay = BLUETOOTH_RECONNECT_MAXIMUM_DELAY;
+  }
+
+  if (asyncSetAlarmIn(&entry->reconnect.alarm, delay, bthHandleReconnectAlarm, entry)) {
+    entry->reconnect.delay = delay;
+  } else {
+    entry->reconnect.alarm = NULL;
+    entry->reconnect.delay = 0;
+  }
+}
+
+static void
+bthStartReconnect (uint64_t bda, uint8_t channel) {
+  BluetoothDeviceEntry *entry = bthGetDeviceEntry(bda, 0);
+
+  if (entry) {
+    if (bthIsReconnecting(entry)) {
+      if (entry->reconnect.channel == channel) return;
+      bthStopReconnect(entry);
+    }
+
+    entry->reconnect.channel = channel;
+    bthScheduleReconnect(entry);
+  }
+}
+
+static BluetoothConnectionExtension *
+bthClaimReconnection (uint64_t bda, uint8_t channel) {
+  BluetoothDeviceEntry *entry = bthGetDeviceEntry(bda, 0);
+
+  if (entry) {
+    BluetoothConnectionExtension *bcx = entry->reconnect.ready;
+
+    if (bcx && (entry->reconnect.channel == channel)) {
+      entry->reconnect.ready = NULL;
+      entry->reconnect.delay = 0;
+      return bcx;
+    }
+  }
+
+  return NULL;
+}
+
+static void
+bthCancelReconnect (uint64_t bda) {
+  BluetoothDeviceEntry *entry = bthGetDeviceEntry(bda, 0);
+  if (entry) bthStopReconnect(entry);
+}
+
 static int
 bthParseAddress (uint64_t *bda, const char *address) {
   const char *character = address;
@@ -160,7 +329,12 @@ bthOpenConnection (const char *address, uint8_t channel, int force) {
     if (bthParseAddress(&connection->address, address)) {
       int alreadyTried = 0;
 
+      if ((connection->extension = bthClaimReconnection(connection->address, connection->channel))) {
+        return connection;
+      }
+
       if (force) {
+        bthCancelReconnect(connection->address);
         bthForgetConnectError(connection->address);
       } else {
         int value;
@@ -182,7 +356,13 @@ bthOpenConnection (const char *address, uint8_t channel, int force) {
 	  approximateDelay(100);
 	}
 
-        bthRememberConnectError(connection->address, errno);
+        {
+          int error = errno;
+
+          bthRememberConnectError(connection->address, error);
+          bthStartReconnect(connection->address, connection->channel);
+          errno = error;
+        }
       }
     }
 
@@ -194,8 +374,27 @@ bthOpenConnection (const char *address, uint8_t channel, int force) {
   return NULL;
 }
 
+static void
+bthStopInputMonitor (BluetoothConnection *connection) {
+  if (connection->inputMonitor) {
+    asyncCancelRequest(connection->inputMonitor);
+    connection->inputMonitor = NULL;
+  }
+}
+
+int
+bthMonitorInput (BluetoothConnection *connection, AsyncMonitorCallback callback, void *data) {
+  bthStopInputMonitor(connection);
+  if (!callback) return 1;
+  if (bthRegisterInputMonitor(connection, callback, data)) return 1;
+
+  connection->inputMonitor = NULL;
+  return 0;
+}
+
 void
 bthCloseConnection (BluetoothConnection *connection) {
+  bthStopInputMonitor(connection);
   bthDisconnect(connection->extension);
   free(connection);
 }
@@ -103,6 +103,24 @@ bthDisconnect (BluetoothConnectionExtension *bcx) {
   free(bcx);
 }
 
+BluetoothConnectionExtension *
+bthStartConnect (uint64_t bda, uint8_t channel) {
+  logUnsupportedFunction();
+  return NULL;
+}
+
+int
+bthMonitorConnect (BluetoothConnectionExtension *bcx, AsyncHandle *handle, AsyncMonitorCallback callback, void *data) {
+  logUnsupportedFunction();
+  return 0;
+}
+
+int
+bthFinishConnect (BluetoothConnectionExtension *bcx) {
+  logUnsupportedFunction();
+  return 0;
+}
+
 int
 bthAwaitInput (BluetoothConnection *connection, int milliseconds) {
   BluetoothConnectionExtension *bcx = connection->extension;
@@ -110,6 +128,13 @@ bthAwaitInput (BluetoothConnection *connection, int milliseconds) {
   return awaitFileInput(bcx->inputPipe[0], milliseconds);
 }
 
+int
+bthRegisterInputMonitor (BluetoothConnection *connection, AsyncMonitorCallback callback, void *data) {
+  BluetoothConnectionExtension *bcx = connection->extension;
+
+  return asyncMonitorFileInput(&connection->inputMonitor, bcx->inputPipe[0], callback, data);
+}
+
 ssize_t
 bthReadData (
   BluetoothConnection *connection, void *buffer, size_t size,
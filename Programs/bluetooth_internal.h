@@ -19,6 +19,8 @@
 #ifndef BRLTTY_INCLUDED_BLUETOOTH_INTERNAL
 #define BRLTTY_INCLUDED_BLUETOOTH_INTERNAL
 
+#include "io_bluetooth.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -31,6 +33,7 @@ struct BluetoothConnectionStruct {
   uint64_t address;
   uint8_t channel;
   BluetoothConnectionExtension *extension;
+  AsyncHandle inputMonitor;
 };
 
 typedef struct {
@@ -42,6 +45,10 @@ extern const BluetoothNameEntry bluetoothNameTable[];
 
 extern BluetoothConnectionExtension *bthConnect (uint64_t bda, uint8_t channel, int timeout);
 extern void bthDisconnect (BluetoothConnectionExtension *bcx);
+extern BluetoothConnectionExtension *bthStartConnect (uint64_t bda, uint8_t channel);
+extern int bthMonitorConnect (BluetoothConnectionExtension *bcx, AsyncHandle *handle, AsyncMonitorCallback callback, void *data);
+extern int bthFinishConnect (BluetoothConnectionExtension *bcx);
+extern int bthRegisterInputMonitor (BluetoothConnection *connection, AsyncMonitorCallback callback, void *data);
 extern char *bthObtainDeviceName (uint64_t bda);
 
 #ifdef __cplusplus
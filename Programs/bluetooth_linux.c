@@ -46,8 +46,8 @@ bthMakeAddress (bdaddr_t *address, uint64_t bda) {
   }
 }
 
-BluetoothConnectionExtension *
-bthConnect (uint64_t bda, uint8_t channel, int timeout) {
+static BluetoothConnectionExtension *
+bthNewConnection (uint64_t bda, uint8_t channel) {
   BluetoothConnectionExtension *bcx;
 
   if ((bcx = malloc(sizeof(*bcx)))) {
@@ -65,15 +65,7 @@ bthConnect (uint64_t bda, uint8_t channel, int timeout) {
         bcx->remote.rc_channel = channel;
         bthMakeAddress(&bcx->remote.rc_bdaddr, bda);
 
-        if (setBlockingIo(bcx->socket, 0)) {
-          if (connectSocket(bcx->socket, (struct sockaddr *)&bcx->remote, sizeof(bcx->remote), timeout) != -1) {
-            return bcx;
-          } else if ((errno != EHOSTDOWN) && (errno != EHOSTUNREACH)) {
-            logSystemError("RFCOMM connect");
-          } else {
-            logMessage(LOG_DEBUG, "Bluetooth connect error: %s", strerror(errno));
-          }
-        }
+        if (setBlockingIo(bcx->socket, 0)) return bcx;
       } else {
         logSystemError("RFCOMM bind");
       }
@@ -91,6 +83,67 @@ bthConnect (uint64_t bda, uint8_t channel, int timeout) {
   return NULL;
 }
 
+static void
+bthLogConnectError (void) {
+  if ((errno != EHOSTDOWN) && (errno != EHOSTUNREACH)) {
+    logSystemError("RFCOMM connect");
+  } else {
+    logMessage(LOG_DEBUG, "Bluetooth connect error: %s", strerror(errno));
+  }
+}
+
+BluetoothConnectionExtension *
+bthConnect (uint64_t bda, uint8_t channel, int timeout) {
+  BluetoothConnectionExtension *bcx;
+
+  if ((bcx = bthNewConnection(bda, channel))) {
+    if (connectSocket(bcx->socket, (struct sockaddr *)&bcx->remote, sizeof(bcx->remote), timeout) != -1) {
+      return bcx;
+    }
+
+    bthLogConnectError();
+    bthDisconnect(bcx);
+  }
+
+  return NULL;
+}
+
+BluetoothConnectionExtension *
+bthStartConnect (uint64_t bda, uint8_t channel) {
+  BluetoothConnectionExtension *bcx;
+
+  if ((bcx = bthNewConnection(bda, channel))) {
+    if (connect(bcx->socket, (struct sockaddr *)&bcx->remote, sizeof(bcx->remote)) != -1) return bcx;
+    if (errno == EINPROGRESS) return bcx;
+
+    bthLogConnectError();
+    bthDisconnect(bcx);
+  }
+
+  return NULL;
+}
+
+int
+bthMonitorConnect (BluetoothConnectionExtension *bcx, AsyncHandle *handle, AsyncMonitorCallback callback, void *data) {
+  return asyncMonitorSocketOutput(handle, bcx->socket, callback, data);
+}
+
+int
+bthFinishConnect (BluetoothConnectionExtension *bcx) {
+  int error;
+  socklen_t length = sizeof(error);
+
+  if (getsockopt(bcx->socket, SOL_SOCKET, SO_ERROR, &error, &length) == -1) {
+    logSystemError("getsockopt[SO_ERROR]");
+    return 0;
+  }
+
+  if (!error) return 1;
+  errno = error;
+  bthLogConnectError();
+  return 0;
+}
+
 void
 bthDisconnect (BluetoothConnectionExtension *bcx) {
   close(bcx->socket);
@@ -104,6 +157,13 @@ bthAwaitInput (BluetoothConnection *connection, int milliseconds) {
   return awaitSocketInput(bcx->socket, milliseconds);
 }
 
+int
+bthRegisterInputMonitor (BluetoothConnection *connection, AsyncMonitorCallback callback, void *data) {
+  BluetoothConnectionExtension *bcx = connection->extension;
+
+  return asyncMonitorSocketInput(&connection->inputMonitor, bcx->socket, callback, data);
+}
+
 ssize_t
 bthReadData (
   BluetoothConnection *connection, void *buffer, size_t size,
@@ -34,12 +34,36 @@ void
 bthDisconnect (BluetoothConnectionExtension *bcx) {
 }
 
+BluetoothConnectionExtension *
+bthStartConnect (uint64_t bda, uint8_t channel) {
+  logUnsupportedFunction();
+  return NULL;
+}
+
+int
+bthMonitorConnect (BluetoothConnectionExtension *bcx, AsyncHandle *handle, AsyncMonitorCallback callback, void *data) {
+  logUnsupportedFunction();
+  return 0;
+}
+
+int
+bthFinishConnect (BluetoothConnectionExtension *bcx) {
+  logUnsupportedFunction();
+  return 0;
+}
+
 int
 bthAwaitInput (BluetoothConnection *connection, int milliseconds) {
   logUnsupportedFunction();
   return 0;
 }
 
+int
+bthRegisterInputMonitor (BluetoothConnection *connection, AsyncMonitorCallback callback, void *data) {
+  logUnsupportedFunction();
+  return 0;
+}
+
 ssize_t
 bthReadData (
   BluetoothConnection *connection, void *buffer, size_t size,
@@ -137,6 +137,24 @@ bthDisconnect (BluetoothConnectionExtension *bcx) {
   free(bcx);
 }
 
+BluetoothConnectionExtension *
+bthStartConnect (uint64_t bda, uint8_t channel) {
+  logUnsupportedFunction();
+  return NULL;
+}
+
+int
+bthMonitorConnect (BluetoothConnectionExtension *bcx, AsyncHandle *handle, AsyncMonitorCallback callback, void *data) {
+  logUnsupportedFunction();
+  return 0;
+}
+
+int
+bthFinishConnect (BluetoothConnectionExtension *bcx) {
+  logUnsupportedFunction();
+  return 0;
+}
+
 int
 bthAwaitInput (BluetoothConnection *connection, int milliseconds) {
   BluetoothConnectionExtension *bcx = connection->extension;
@@ -166,6 +184,13 @@ bthAwaitInput (BluetoothConnection *connection, int milliseconds) {
   return 0;
 }
 
+int
+bthRegisterInputMonitor (BluetoothConnection *connection, AsyncMonitorCallback callback, void *data) {
+  BluetoothConnectionExtension *bcx = connection->extension;
+
+  return asyncMonitorSocketInput(&connection->inputMonitor, bcx->socket, callback, data);
+}
+
 ssize_t
 bthReadData (
   BluetoothConnection *connection, void *buffer, size_t size,
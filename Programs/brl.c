@@ -31,6 +31,7 @@
 #include "unicode.h"
 #include "drivers.h"
 #include "io_generic.h"
+#include "keytrace.h"
 #include "brl.h"
 #include "ttb.h"
 #include "ktb.h"
@@ -119,6 +120,8 @@ initializeBrailleDisplay (BrailleDisplay *brl) {
 
   brl->buffer = NULL;
   brl->writeDelay = 0;
+  getMonotonicTime(&brl->frameReadyTime);
+  brl->framePending = 0;
   brl->bufferResized = NULL;
   brl->touchEnabled = 0;
   brl->highlightWindow = 0;
@@ -137,6 +140,39 @@ drainBrailleOutput (BrailleDisplay *brl, int minimumDelay) {
   return duration;
 }
 
+int
+canWriteBrailleFrame (BrailleDisplay *brl) {
+  TimeValue now;
+
+  getMonotonicTime(&now);
+  brl->framePending = millisecondsBetween(&now, &brl->frameReadyTime) > 0;
+  return !brl->framePending;
+}
+
+void
+wroteBrailleFrame (BrailleDisplay *brl) {
+  markWrittenKeyTraces();
+
+  /* the link is busy until everything written so far has been transferred */
+  getMonotonicTime(&brl->frameReadyTime);
+  adjustTimeValue(&brl->frameReadyTime, brl->writeDelay);
+  brl->writeDelay = 0;
+}
+
+int
+getBrailleFrameDelay (BrailleDisplay *brl, int interval) {
+  if (brl->framePending) {
+    TimeValue now;
+    long int delay;
+
+    getMonotonicTime(&now);
+    delay = millisecondsBetween(&now, &brl->frameReadyTime);
+    if (delay < interval) interval = MAX(delay, 0);
+  }
+
+  return interval;
+}
+
 static void
 fillRegion (
   wchar_t *text, unsigned char *dots,
@@ -287,6 +323,7 @@ ensureBrailleBuffer (BrailleDisplay *brl, int infoLevel) {
 
 typedef struct {
   int command;
+  unsigned int trace;
 } CommandQueueItem;
 
 static Queue *
@@ -310,6 +347,7 @@ enqueueCommand (int command) {
 
       if (item) {
         item->command = command;
+        item->trace = getKeyTrace();
         if (enqueueItem(queue, item)) return 1;
 
         free(item);
@@ -329,6 +367,7 @@ dequeueCommand (void) {
 
     while ((item = dequeueItem(queue))) {
       int command = item->command;
+      resumeKeyTrace(item->trace);
       free(item);
 
 #ifdef ENABLE_API
@@ -348,6 +387,7 @@ typedef struct {
   unsigned char set;
   unsigned char key;
   unsigned press:1;
+  unsigned int trace;
 } KeyEvent;
 
 static const int keyReleaseTimeout = 0;
@@ -405,6 +445,7 @@ enqueueKeyEvent (unsigned char set, unsigned char key, int press) {
       event->set = set;
       event->key = key;
       event->press = press;
+      event->trace = startKeyTrace();
 
       if (keyReleaseTimeout && !press) {
         keyReleaseEvent = event;
@@ -423,7 +464,7 @@ enqueueKeyEvent (unsigned char set, unsigned char key, int press) {
 }
 
 static int
-dequeueKeyEvent (unsigned char *set, unsigned char *key, int *press) {
+dequeueKeyEvent (unsigned char *set, unsigned char *key, int *press, unsigned int *trace) {
   Queue *queue = getKeyEventQueue(0);
 
   if (keyReleaseEvent) {
@@ -449,6 +490,7 @@ dequeueKeyEvent (unsigned char *set, unsigned char *key, int *press) {
       *set = event->set;
       *key = event->key;
       *press = event->press;
+      *trace = event->trace;
       free(event);
       return 1;
     }
@@ -558,8 +600,11 @@ readBrailleCommand (BrailleDisplay *brl, KeyTableCommandContext context) {
       unsigned char set;
       unsigned char key;
       int press;
+      unsigned int trace;
+
+      while (dequeueKeyEvent(&set, &key, &press, &trace)) {
+        resumeKeyTrace(trace);
 
-      while (dequeueKeyEvent(&set, &key, &press)) {
         if (brl->keyTable) {
           switch (prefs.brailleOrientation) {
             case BRL_ORIENTATION_ROTATED:
@@ -574,6 +619,8 @@ readBrailleCommand (BrailleDisplay *brl, KeyTableCommandContext context) {
           processKeyEvent(brl->keyTable, context, set, key, press);
         }
       }
+
+      resumeKeyTrace(0);
     }
 
     if (command != EOF) enqueueCommand(command);
@@ -583,13 +630,34 @@ readBrailleCommand (BrailleDisplay *brl, KeyTableCommandContext context) {
     int command = dequeueCommand();
 
 #ifdef ENABLE_API
-    if (command == EOF) command = api_handleCommand(command);
+    if (apiStarted)
+      if (command == EOF)
+        command = api_handleCommand(command);
 #endif /* ENABLE_API */
 
     return command;
   }
 }
 
+static int
+readFramedPacket (
+  GioEndpoint *endpoint,
+  unsigned char *bytes, size_t *count, size_t length
+) {
+  while (*count < length) {
+    ssize_t result = gioReadData(endpoint, &bytes[*count], length-*count, 1);
+
+    if (result < 1) {
+      if (result == 0) errno = EAGAIN;
+      return 0;
+    }
+
+    *count += result;
+  }
+
+  return 1;
+}
+
 size_t
 readBraillePacket (
   BrailleDisplay *brl,
@@ -597,40 +665,82 @@ readBraillePacket (
   void *packet, size_t size,
   BraillePacketVerifier verifyPacket, void *data
 ) {
+  GioStatistics *statistics = gioGetStatistics(endpoint);
   unsigned char *bytes = packet;
   size_t count = 0;
   size_t length = 1;
+  TimeValue start;
+
+  /* the bytes of a rejected framed packet which are still to be examined */
+  size_t next = 0;
+  size_t end = 0;
 
   while (1) {
     unsigned char byte;
 
-    {
+    if (next < end) {
+      byte = bytes[next++];
+    } else {
       int started = count > 0;
 
       if (!gioReadByte(endpoint, &byte, started)) {
-        if (started) logPartialPacket(bytes, count);
+        if (started) {
+          logPartialPacket(bytes, count);
+          statistics->input.partialPackets += 1;
+        }
+
         return 0;
       }
     }
 
   gotByte:
     if (count < size) {
+      if (!count) getMonotonicTime(&start);
       bytes[count++] = byte;
 
-      if (!verifyPacket(brl, bytes, count, &length, data)) {
-        if (--count) {
-          logShortPacket(bytes, count);
-          count = 0;
-          length = 1;
-          goto gotByte;
-        }
+      switch (verifyPacket(brl, bytes, count, &length, data)) {
+        case BRL_PVR_INVALID:
+          if (--count) {
+            logShortPacket(bytes, count);
+            statistics->input.corruptPackets += 1;
+            count = 0;
+            length = 1;
+            goto gotByte;
+          }
 
-        logIgnoredByte(byte);
-        continue;
+          logIgnoredByte(byte);
+          continue;
+
+        case BRL_PVR_FRAMED:
+          if ((next == end) && (length > count) && (length <= size)) {
+            if (!readFramedPacket(endpoint, bytes, &count, length)) {
+              logPartialPacket(bytes, count);
+              statistics->input.partialPackets += 1;
+              return 0;
+            }
+
+            if (!verifyPacket(brl, bytes, count, &length, data)) {
+              logCorruptPacket(bytes, count);
+              statistics->input.corruptPackets += 1;
+
+              /* resynchronize from the byte after the one which started it */
+              next = 1;
+              end = count;
+              count = 0;
+              length = 1;
+              continue;
+            }
+          }
+          /* fall through */
+
+        default:
+          break;
       }
 
       if (count == length) {
         logInputPacket(bytes, length);
+        statistics->input.packets += 1;
+        gioAddToHistogram(&statistics->input.packetAssemblyTime, getMonotonicElapsed(&start));
         return length;
       }
     } else {
@@ -647,6 +757,7 @@ writeBraillePacket (
 ) {
   logOutputPacket(packet, size);
   if (gioWriteData(endpoint, packet, size) == -1) return 0;
+  gioGetStatistics(endpoint)->output.packets += 1;
   brl->writeDelay += gioGetMillisecondsToTransfer(endpoint, size);
   return 1;
 }
@@ -771,6 +882,133 @@ cellsHaveChanged (
   return 1;
 }
 
+typedef struct {
+  unsigned int from;
+  unsigned int to;
+} CellRange;
+
+typedef struct {
+  unsigned int size;
+  unsigned int index;
+} CellGap;
+
+static int
+compareCellGaps (const void *element1, const void *element2) {
+  const CellGap *gap1 = element1;
+  const CellGap *gap2 = element2;
+
+  if (gap1->size < gap2->size) return -1;
+  if (gap1->size > gap2->size) return 1;
+  return 0;
+}
+
+static unsigned int
+mergeCellRanges (CellRange *ranges, unsigned int count, const BrailleUpdateModel *model) {
+  unsigned int gapCount = count - 1;
+  unsigned char merge[gapCount];
+  unsigned int remaining = count;
+
+  {
+    unsigned int index;
+
+    /* sending the unchanged cells between two ranges is cheaper than a new range */
+    for (index=0; index<gapCount; index+=1) {
+      if ((merge[index] = ((ranges[index+1].from - ranges[index].to) <= model->rangeOverhead))) {
+        remaining -= 1;
+      }
+    }
+  }
+
+  if (model->maximumRanges && (remaining > model->maximumRanges)) {
+    CellGap gaps[gapCount];
+    unsigned int size = 0;
+    unsigned int index;
+
+    for (index=0; index<gapCount; index+=1) {
+      if (!merge[index]) {
+        CellGap *gap = &gaps[size++];
+        gap->size = ranges[index+1].from - ranges[index].to;
+        gap->index = index;
+      }
+    }
+
+    /* closing the smallest gaps adds the fewest unchanged cells */
+    qsort(gaps, size, sizeof(*gaps), compareCellGaps);
+
+    for (index=0; remaining>model->maximumRanges; index+=1) {
+      merge[gaps[index].index] = 1;
+      remaining -= 1;
+    }
+  }
+
+  {
+    unsigned int from = 0;
+    unsigned int to = 0;
+
+    while (from < count) {
+      ranges[to].from = ranges[from].from;
+      while ((from < gapCount) && merge[from]) from += 1;
+      ranges[to++].to = ranges[from++].to;
+    }
+
+    return to;
+  }
+}
+
+int
+writeChangedCells (
+  BrailleDisplay *brl,
+  unsigned char *cells, const unsigned char *new, unsigned int count, int *force,
+  const BrailleUpdateModel *model,
+  BrailleRangeWriter *writeRange, void *data
+) {
+  if (count) {
+    CellRange ranges[(count + 1) / 2];
+    unsigned int rangeCount = 0;
+
+    if ((force && *force) || model->wholeLine) {
+      if ((force && *force) || (memcmp(cells, new, count) != 0)) {
+        CellRange *range = &ranges[rangeCount++];
+        range->from = 0;
+        range->to = count;
+      }
+    } else {
+      unsigned int index = 0;
+
+      while (index < count) {
+        if (cells[index] != new[index]) {
+          CellRange *range = &ranges[rangeCount++];
+          range->from = index;
+
+          while (++index < count) {
+            if (cells[index] == new[index]) break;
+          }
+
+          range->to = index;
+        } else {
+          index += 1;
+        }
+      }
+
+      if (rangeCount > 1) rangeCount = mergeCellRanges(ranges, rangeCount, model);
+    }
+
+    {
+      const CellRange *range = ranges;
+      const CellRange *end = range + rangeCount;
+
+      while (range < end) {
+        if (!writeRange(brl, new, range->from, range->to, data)) return 0;
+        memcpy(&cells[range->from], &new[range->from], range->to - range->from);
+        range += 1;
+      }
+    }
+  }
+
+  if (force) *force = 0;
+  return 1;
+}
+
 int
 textHasChanged (
   wchar_t *text, const wchar_t *new, unsigned int count,
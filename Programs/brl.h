@@ -22,6 +22,7 @@
 #include "prologue.h"
 
 #include "driver.h"
+#include "timing.h"
 #include "io_generic.h"
 #include "brldefs.h"
 #include "ktbdefs.h"
@@ -51,6 +52,8 @@ struct BrailleDisplayStruct {
   unsigned resizeRequired:1;
   unsigned noDisplay:1;
   unsigned int writeDelay;
+  TimeValue frameReadyTime;
+  unsigned framePending:1;
   void (*bufferResized) (unsigned int rows, unsigned int columns);
   unsigned touchEnabled:1;
   unsigned highlightWindow:1;
@@ -63,6 +66,13 @@ struct BrailleDisplayStruct {
 
 extern void initializeBrailleDisplay (BrailleDisplay *brl);
 extern unsigned int drainBrailleOutput (BrailleDisplay *brl, int minimumDelay);
+
+/* Pacing of the periodic window update: a frame isn't written while the
+ * previous one is still being transferred - the next update supersedes it.
+ */
+extern int canWriteBrailleFrame (BrailleDisplay *brl);
+extern void wroteBrailleFrame (BrailleDisplay *brl);
+extern int getBrailleFrameDelay (BrailleDisplay *brl, int interval);
 extern int ensureBrailleBuffer (BrailleDisplay *brl, int infoLevel);
 
 extern void fillTextRegion (
@@ -97,6 +107,16 @@ extern int enqueueXtScanCode (
 extern int readBrailleCommand (BrailleDisplay *, KeyTableCommandContext);
 extern KeyTableCommandContext getCurrentCommandContext (void);
 
+typedef enum {
+  BRL_PVR_INVALID,
+  BRL_PVR_INCLUDE,
+
+  /* *length is now final: the rest of the packet is read in bulk
+   * and then verified once (with size == *length) as a whole
+   */
+  BRL_PVR_FRAMED
+} BraillePacketVerifierResult;
+
 typedef int BraillePacketVerifier (
   BrailleDisplay *brl,
   const unsigned char *bytes, size_t size,
@@ -183,6 +203,25 @@ extern int cellsHaveChanged (
   unsigned int *from, unsigned int *to, int *force
 );
 
+typedef struct {
+  unsigned int rangeOverhead; /* bytes each written range costs besides its cells */
+  unsigned int maximumRanges; /* most ranges written per update (0 for no limit) */
+  unsigned wholeLine:1;       /* the device can only be sent complete lines */
+} BrailleUpdateModel;
+
+typedef int BrailleRangeWriter (
+  BrailleDisplay *brl,
+  const unsigned char *cells, unsigned int from, unsigned int to,
+  void *data
+);
+
+extern int writeChangedCells (
+  BrailleDisplay *brl,
+  unsigned char *cells, const unsigned char *new, unsigned int count, int *force,
+  const BrailleUpdateModel *model,
+  BrailleRangeWriter *writeRange, void *data
+);
+
 extern int textHasChanged (
   wchar_t *text, const wchar_t *new, unsigned int count,
   unsigned int *from, unsigned int *to, int *force
@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <locale.h>
 
 #ifndef __MINGW32__
@@ -58,8 +59,6 @@
 
 #ifdef HAVE_SYS_SELECT_H
 #include <sys/select.h>
-#else /* HAVE_SYS_SELECT_H */
-#include <sys/time.h>
 #endif /* HAVE_SYS_SELECT_H */
 
 #endif /* __MINGW32__ */
@@ -154,20 +153,59 @@ static WIN_PROC_STUB(freeaddrinfo);
 
 #endif /* weak external references */
 
-/** key presses buffer size
+/** key presses buffer sizes
  *
- * key presses won't be lost provided no more than BRL_KEYBUF_SIZE key presses
- * are done between two calls to brlapi_read* if a call to another function is
- * done in the meanwhile (which needs somewhere to put them before being able
- * to get responses from the server)
+ * the buffer starts with BRL_KEYBUF_SIZE entries and doubles whenever needed,
+ * so that key presses won't be lost provided no more than BRL_KEYBUF_MAXSIZE
+ * key presses are done between two calls to brlapi_read* if a call to another
+ * function is done in the meanwhile (which needs somewhere to put them before
+ * being able to get responses from the server), or arrive as a batch
 */
 #define BRL_KEYBUF_SIZE 256
+#define BRL_KEYBUF_MAXSIZE 0X10000
+
+/* A buffered key press */
+typedef struct {
+  brlapi_keyCode_t code;
+  uint64_t time; /* milliseconds since the Epoch */
+} brlapi_bufferedKey_t;
+
+/** maximum number of asynchronous requests in flight or waiting for their
+ * completion to be fetched */
+#define BRL_MAXPENDING 64
+
+/* An asynchronous request waiting for its answer */
+typedef struct {
+  brlapi_token_t token;
+  brlapi_packetType_t type; /* of the request */
+  int report; /* whether its completion is reported, else only its error is */
+} brlapi_pendingRequest_t;
+
+/* An answered asynchronous request waiting to be fetched */
+typedef struct {
+  brlapi_token_t token;
+  brlapi_packetType_t type; /* of the request */
+  int error;
+} brlapi_completedRequest_t;
 
 struct brlapi_handle_t { /* Connection-specific information */
   unsigned int brlx;
   unsigned int brly;
   brlapi_fileDescriptor fileDescriptor; /* Descriptor of the socket connected to BrlApi */
   int addrfamily; /* Address family of the socket */
+  uint32_t serverFeatures; /* BRLAPI_FEATURE_* announced by the server */
+#ifdef BRLAPI_SHARED_MEMORY
+  /* shared memory rings, only when region isn't NULL */
+  /* requests is protected by fileDescriptor_mutex, keys by key_mutex */
+  struct {
+    void *region;
+    size_t size;
+    int requestEvent;
+    int keyEvent;
+    brlapi_sharedQueue_t requests;
+    brlapi_sharedQueue_t keys;
+  } shared;
+#endif /* BRLAPI_SHARED_MEMORY */
   /* to protect concurrent fd write operations */
   pthread_mutex_t fileDescriptor_mutex;
   /* to protect concurrent fd requests */
@@ -194,9 +232,24 @@ struct brlapi_handle_t { /* Connection-specific information */
    * acknowledgements for instance
    *
    * every function must hence be able to read at least sizeof(brlapi_keyCode_t) */
-  brlapi_keyCode_t keybuf[BRL_KEYBUF_SIZE];
+  brlapi_bufferedKey_t *keybuf;
+  unsigned keybuf_size;
   unsigned keybuf_next;
   unsigned keybuf_nb;
+  /* asynchronous requests, protected by read_mutex: since the server answers
+   * requests in order, any answer received while some are pending is for the
+   * oldest one */
+  brlapi_pendingRequest_t pending[BRL_MAXPENDING];
+  unsigned pending_next;
+  unsigned pending_nb;
+  brlapi_completedRequest_t completed[BRL_MAXPENDING];
+  unsigned completed_next;
+  unsigned completed_nb;
+  brlapi_token_t lastToken;
+  brlapi_token_t errorToken; /* first error for an unreported part of a request */
+  int error;
+  int completionPipe[2]; /* a byte per entry of completed */
+  int keyPipe[2]; /* holds a byte while keybuf isn't empty */
   union {
     brlapi_exceptionHandler_t withoutHandle;
     brlapi__exceptionHandler_t withHandle;
@@ -220,6 +273,13 @@ static void brlapi_initializeHandle(brlapi_handle_t *handle)
   handle->brly = 0;
   handle->fileDescriptor = INVALID_FILE_DESCRIPTOR;
   handle->addrfamily = 0;
+  handle->serverFeatures = 0;
+#ifdef BRLAPI_SHARED_MEMORY
+  handle->shared.region = NULL;
+  handle->shared.size = 0;
+  handle->shared.requestEvent = -1;
+  handle->shared.keyEvent = -1;
+#endif /* BRLAPI_SHARED_MEMORY */
   pthread_mutex_init(&handle->fileDescriptor_mutex, NULL);
   pthread_mutex_init(&handle->req_mutex, NULL);
   pthread_mutex_init(&handle->key_mutex, NULL);
@@ -232,9 +292,19 @@ static void brlapi_initializeHandle(brlapi_handle_t *handle)
   handle->altSem = NULL;
   handle->state = 0;
   pthread_mutex_init(&handle->state_mutex, NULL);
-  memset(handle->keybuf, 0, sizeof(handle->keybuf));
+  handle->keybuf = NULL;
+  handle->keybuf_size = 0;
   handle->keybuf_next = 0;
   handle->keybuf_nb = 0;
+  handle->pending_next = 0;
+  handle->pending_nb = 0;
+  handle->completed_next = 0;
+  handle->completed_nb = 0;
+  handle->lastToken = 0;
+  handle->errorToken = 0;
+  handle->error = BRLAPI_ERROR_SUCCESS;
+  handle->completionPipe[0] = handle->completionPipe[1] = -1;
+  handle->keyPipe[0] = handle->keyPipe[1] = -1;
   if (handle == &defaultHandle)
     handle->exceptionHandler.withoutHandle = brlapi_defaultExceptionHandler;
   else
@@ -242,6 +312,195 @@ static void brlapi_initializeHandle(brlapi_handle_t *handle)
   pthread_mutex_init(&handle->exceptionHandler_mutex, NULL);
 }
 
+/* brlapi_getTime */
+/* Returns the number of milliseconds since the Epoch */
+static uint64_t brlapi_getTime(void)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (uint64_t)now.tv_sec*1000 + now.tv_usec/1000;
+}
+
+/* brlapi_signalBufferedKeys */
+/* Makes the descriptor given by brlapi_getKeyFileDescriptor readable while */
+/* keys are buffered, given whether there were any before */
+/* must be called with read_mutex locked */
+static void brlapi__signalBufferedKeys(brlapi_handle_t *handle, int wereBuffered)
+{
+  char byte;
+#ifdef BRLAPI_SHARED_MEMORY
+  if (handle->shared.region) {
+    /* also cleared when the ring gets read, so raise it again each time */
+    if (handle->keybuf_nb) eventfd_write(handle->shared.keyEvent, 1);
+    return;
+  }
+#endif /* BRLAPI_SHARED_MEMORY */
+  if (handle->keyPipe[1] == -1) return;
+  if (handle->keybuf_nb && !wereBuffered) {
+    if (write(handle->keyPipe[1], "", 1) == -1)
+      syslog(LOG_WARNING,"(brlapi_signalBufferedKeys) couldn't signal keys: %s\n",strerror(errno));
+  } else if (!handle->keybuf_nb && wereBuffered) {
+    if (read(handle->keyPipe[0], &byte, 1) == -1) {}
+  }
+}
+
+/* brlapi_countSocketKeys */
+/* Tells the server how many more of the keys it sent through the socket */
+/* rather than through the shared memory ring have been taken */
+/* must be called with read_mutex locked */
+static void brlapi__countSocketKeys(brlapi_handle_t *handle, unsigned count)
+{
+#ifdef BRLAPI_SHARED_MEMORY
+  if (handle->shared.region && count) {
+    volatile brlapi_sharedMemoryHeader_t *header = handle->shared.region;
+    __sync_synchronize();
+    header->socketKeys += count;
+  }
+#endif /* BRLAPI_SHARED_MEMORY */
+}
+
+/* brlapi_clearKeyBuffer */
+/* Drops the buffered key presses */
+/* must be called with read_mutex locked */
+static void brlapi__clearKeyBuffer(brlapi_handle_t *handle)
+{
+  int wereBuffered = handle->keybuf_nb != 0;
+  brlapi__countSocketKeys(handle, handle->keybuf_nb);
+  handle->keybuf_next = handle->keybuf_nb = 0;
+  brlapi__signalBufferedKeys(handle, wereBuffered);
+}
+
+/* brlapi_bufferKey */
+/* Appends a key press to the key buffer, growing it if needed */
+/* must be called with read_mutex locked */
+static void brlapi__bufferKey(brlapi_handle_t *handle, brlapi_keyCode_t code, uint64_t time)
+{
+  brlapi_bufferedKey_t *key;
+
+  if (handle->keybuf_nb==handle->keybuf_size) {
+    unsigned size = handle->keybuf_size? 2*handle->keybuf_size: BRL_KEYBUF_SIZE;
+    brlapi_bufferedKey_t *keybuf;
+    unsigned i;
+
+    if ((size>BRL_KEYBUF_MAXSIZE) || !(keybuf = malloc(size*sizeof(*keybuf)))) {
+      syslog(LOG_WARNING,"lost key: 0X%016"BRLAPI_PRIxKEYCODE"\n",code);
+      brlapi__countSocketKeys(handle, 1);
+      return;
+    }
+    for (i=0; i<handle->keybuf_nb; i++)
+      keybuf[i] = handle->keybuf[(handle->keybuf_next+i)%handle->keybuf_size];
+    free(handle->keybuf);
+    handle->keybuf = keybuf;
+    handle->keybuf_size = size;
+    handle->keybuf_next = 0;
+  }
+
+  key = &handle->keybuf[(handle->keybuf_next+handle->keybuf_nb++)%handle->keybuf_size];
+  key->code = code;
+  key->time = time;
+  brlapi__signalBufferedKeys(handle, handle->keybuf_nb > 1);
+}
+
+/* brlapi_unbufferKey */
+/* Takes the oldest key press from the key buffer */
+/* Returns 0 if there is none */
+/* must be called with read_mutex locked */
+static int brlapi__unbufferKey(brlapi_handle_t *handle, brlapi_keyCode_t *code, uint64_t *time)
+{
+  const brlapi_bufferedKey_t *key;
+
+  if (!handle->keybuf_nb) return 0;
+  key = &handle->keybuf[handle->keybuf_next];
+  *code = key->code;
+  if (time) *time = key->time;
+  handle->keybuf_next = (handle->keybuf_next+1)%handle->keybuf_size;
+  handle->keybuf_nb--;
+  brlapi__countSocketKeys(handle, 1);
+  brlapi__signalBufferedKeys(handle, 1);
+  return 1;
+}
+
+/* brlapi_recordCompletion */
+/* Queues the outcome of an asynchronous request for brlapi_getCompletion */
+/* must be called with read_mutex locked */
+static void brlapi__recordCompletion(brlapi_handle_t *handle, brlapi_token_t token, brlapi_packetType_t type, int error)
+{
+  brlapi_completedRequest_t *completion;
+
+  completion = &handle->completed[(handle->completed_next+handle->completed_nb++)%BRL_MAXPENDING];
+  completion->token = token;
+  completion->type = type;
+  completion->error = error;
+  if (handle->completionPipe[1] != -1)
+    if (write(handle->completionPipe[1], "", 1) == -1)
+      syslog(LOG_WARNING,"(brlapi_recordCompletion) couldn't signal completion: %s\n",strerror(errno));
+}
+
+/* brlapi_completeRequest */
+/* Records the answer to the oldest pending asynchronous request */
+/* must be called with read_mutex locked */
+static void brlapi__completeRequest(brlapi_handle_t *handle, brlapi_packetType_t type, const brlapi_packet_t *packet, size_t size)
+{
+  brlapi_pendingRequest_t *request = &handle->pending[handle->pending_next];
+  int error = BRLAPI_ERROR_SUCCESS;
+
+  handle->pending_next = (handle->pending_next+1)%BRL_MAXPENDING;
+  handle->pending_nb--;
+
+  if (type==BRLAPI_PACKET_ERROR) {
+    error = ntohl(packet->error.code);
+  } else if (request->type==BRLAPI_PACKET_GETDISPLAYSIZE) {
+    if ((type==BRLAPI_PACKET_GETDISPLAYSIZE) && (size==2*sizeof(uint32_t))) {
+      const uint32_t *dimensions = &packet->uint32;
+      handle->brlx = ntohl(dimensions[0]);
+      handle->brly = ntohl(dimensions[1]);
+    } else {
+      error = BRLAPI_ERROR_INVALID_PACKET;
+    }
+  } else if (type!=BRLAPI_PACKET_ACK) {
+    error = BRLAPI_ERROR_INVALID_PACKET;
+  }
+
+  if (!request->report) {
+    /* keep the first one, unless it's been left by a request which failed to be sent */
+    if (error!=BRLAPI_ERROR_SUCCESS && (handle->error==BRLAPI_ERROR_SUCCESS || handle->errorToken!=request->token)) {
+      handle->errorToken = request->token;
+      handle->error = error;
+    }
+    return;
+  }
+
+  if (handle->error!=BRLAPI_ERROR_SUCCESS && handle->errorToken==request->token) {
+    error = handle->error;
+    handle->error = BRLAPI_ERROR_SUCCESS;
+  }
+
+  brlapi__recordCompletion(handle, request->token, request->type, error);
+}
+
+/* brlapi_failAsync */
+/* Makes an asynchronous request of several packets complete with the current */
+/* error when one of them but the first couldn't be sent */
+/* must be called with req_mutex locked */
+static void brlapi__failAsync(brlapi_handle_t *handle, brlapi_token_t token, brlapi_packetType_t type)
+{
+  pthread_mutex_lock(&handle->read_mutex);
+  if (handle->error==BRLAPI_ERROR_SUCCESS || handle->errorToken!=token) {
+    handle->errorToken = token;
+    handle->error = brlapi_errno;
+  }
+  if (handle->pending_nb &&
+      handle->pending[(handle->pending_next+handle->pending_nb-1)%BRL_MAXPENDING].token==token) {
+    /* the answer to the last packet which was sent completes it */
+    handle->pending[(handle->pending_next+handle->pending_nb-1)%BRL_MAXPENDING].report = 1;
+  } else {
+    /* all of them have been answered already */
+    brlapi__recordCompletion(handle, token, type, handle->error);
+    handle->error = BRLAPI_ERROR_SUCCESS;
+  }
+  pthread_mutex_unlock(&handle->read_mutex);
+}
+
 /* brlapi_doWaitForPacket */
 /* Waits for the specified type of packet: must be called with brlapi_req_mutex locked */
 /* If the right packet type arrives, returns its size */
@@ -259,6 +518,22 @@ static ssize_t brlapi__doWaitForPacket(brlapi_handle_t *handle, brlapi_packetTyp
 
   res = brlapi_readPacketHeader(handle->fileDescriptor, &type);
   if (res<0) return res; /* reports EINTR too */
+
+  if ((type==BRLAPI_PACKET_ACK) || (type==BRLAPI_PACKET_ERROR) || (type==BRLAPI_PACKET_GETDISPLAYSIZE)) {
+    /* Answer to an asynchronous request? */
+    pthread_mutex_lock(&handle->read_mutex);
+    if (handle->pending_nb) {
+      brlapi_packet_t answer;
+      if ((res = brlapi_readPacketContent(handle->fileDescriptor, res, &answer, sizeof(answer))) >= 0) {
+        brlapi__completeRequest(handle, type, &answer, res);
+        res = -3;
+      }
+      pthread_mutex_unlock(&handle->read_mutex);
+      return res;
+    }
+    pthread_mutex_unlock(&handle->read_mutex);
+  }
+
   if (type==expectedPacketType)
     /* For us, just read */
     return brlapi_readPacketContent(handle->fileDescriptor, res, packet, size);
@@ -284,10 +559,20 @@ static ssize_t brlapi__doWaitForPacket(brlapi_handle_t *handle, brlapi_packetTyp
   }
   if ((type==BRLAPI_PACKET_KEY) && (handle->state & STCONTROLLINGTTY) && (res==sizeof(brlapi_keyCode_t))) {
     /* keypress, buffer it */
-    if (handle->keybuf_nb>=BRL_KEYBUF_SIZE) {
-      syslog(LOG_WARNING,"lost key: 0X%8lx%8lx\n",(unsigned long)ntohl(uint32Packet[0]),(unsigned long)ntohl(uint32Packet[1]));
+    brlapi__bufferKey(handle, ((brlapi_keyCode_t)ntohl(uint32Packet[0]) << 32) | ntohl(uint32Packet[1]), brlapi_getTime());
+    pthread_mutex_unlock(&handle->read_mutex);
+    return -3;
+  }
+  if (type==BRLAPI_PACKET_KEYS) {
+    /* batch of keypresses, always buffered so that they're read one by one */
+    if ((handle->state & STCONTROLLINGTTY) && !(res%sizeof(brlapi_batchedKey_t))) {
+      const brlapi_batchedKey_t *keys = (const brlapi_batchedKey_t *) &localPacket;
+      uint64_t now = brlapi_getTime();
+      unsigned i;
+      for (i=0; i<res/sizeof(*keys); i++)
+        brlapi__bufferKey(handle, ((brlapi_keyCode_t)ntohl(keys[i].code[0]) << 32) | ntohl(keys[i].code[1]), now-ntohl(keys[i].age));
     } else {
-      handle->keybuf[(handle->keybuf_next+handle->keybuf_nb++)%BRL_KEYBUF_SIZE]=ntohl(*uint32Packet);
+      brlapi__countSocketKeys(handle, res/sizeof(brlapi_batchedKey_t));
     }
     pthread_mutex_unlock(&handle->read_mutex);
     return -3;
@@ -663,7 +948,11 @@ brlapi_fileDescriptor BRLAPI_STDCALL brlapi__openConnection(brlapi_handle_t *han
     goto outfd;
   }
 
-  if (brlapi_writePacket(handle->fileDescriptor, BRLAPI_PACKET_VERSION, version, sizeof(*version)) < 0)
+  /* older servers don't announce any feature */
+  if (len >= sizeof(*version))
+    handle->serverFeatures = ntohl(version->features);
+
+  if (brlapi_writePacket(handle->fileDescriptor, BRLAPI_PACKET_VERSION, version, sizeof(version->protocolVersion)) < 0)
     goto outfd;
 
   if ((len = brlapi__waitForPacket(handle, BRLAPI_PACKET_AUTH, &serverPacket, sizeof(serverPacket), 1)) < 0)
@@ -715,6 +1004,27 @@ brlapi_fileDescriptor BRLAPI_STDCALL brlapi_openConnection(const brlapi_connecti
   return brlapi__openConnection(&defaultHandle, clientSettings, usedSettings);
 }
 
+#ifdef BRLAPI_SHARED_MEMORY
+/* brlapi_releaseSharedMemory */
+/* Unmaps the shared memory region and closes its event descriptors */
+/* must be called with fileDescriptor_mutex locked */
+static void brlapi__releaseSharedMemory(brlapi_handle_t *handle)
+{
+  if (handle->shared.region) {
+    munmap(handle->shared.region, handle->shared.size);
+    handle->shared.region = NULL;
+  }
+  if (handle->shared.requestEvent >= 0) {
+    close(handle->shared.requestEvent);
+    handle->shared.requestEvent = -1;
+  }
+  if (handle->shared.keyEvent >= 0) {
+    close(handle->shared.keyEvent);
+    handle->shared.keyEvent = -1;
+  }
+}
+#endif /* BRLAPI_SHARED_MEMORY */
+
 /* brlapi_closeConnection */
 /* Cleanly close the socket */
 void BRLAPI_STDCALL brlapi__closeConnection(brlapi_handle_t *handle)
@@ -725,7 +1035,27 @@ void BRLAPI_STDCALL brlapi__closeConnection(brlapi_handle_t *handle)
   pthread_mutex_lock(&handle->fileDescriptor_mutex);
   closeFileDescriptor(handle->fileDescriptor);
   handle->fileDescriptor = INVALID_FILE_DESCRIPTOR;
+#ifdef BRLAPI_SHARED_MEMORY
+  brlapi__releaseSharedMemory(handle);
+#endif /* BRLAPI_SHARED_MEMORY */
   pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  pthread_mutex_lock(&handle->read_mutex);
+  free(handle->keybuf);
+  handle->keybuf = NULL;
+  handle->keybuf_size = handle->keybuf_next = handle->keybuf_nb = 0;
+  handle->pending_nb = 0;
+  handle->completed_nb = 0;
+  if (handle->completionPipe[0] != -1) {
+    close(handle->completionPipe[0]);
+    close(handle->completionPipe[1]);
+    handle->completionPipe[0] = handle->completionPipe[1] = -1;
+  }
+  if (handle->keyPipe[0] != -1) {
+    close(handle->keyPipe[0]);
+    close(handle->keyPipe[1]);
+    handle->keyPipe[0] = handle->keyPipe[1] = -1;
+  }
+  pthread_mutex_unlock(&handle->read_mutex);
 #ifdef __MINGW32__
   WSACleanup();
 #endif /* __MINGW32__ */
@@ -736,6 +1066,178 @@ void BRLAPI_STDCALL brlapi_closeConnection(void)
   brlapi__closeConnection(&defaultHandle);
 }
 
+/* brlapi_enableSharedMemory */
+/* Moves write and key traffic to shared memory rings */
+int BRLAPI_STDCALL brlapi__enableSharedMemory(brlapi_handle_t *handle, size_t ringSize)
+{
+#ifdef BRLAPI_SHARED_MEMORY
+  brlapi_sharedMemoryHeader_t *header;
+  brlapi_header_t packetHeader;
+  brlapi_sharedMemoryPacket_t packet;
+  struct iovec iov[2];
+  struct msghdr msg;
+  union {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE(3 * sizeof(int))];
+  } control;
+  struct cmsghdr *cmsg;
+  uint32_t dataOffset;
+  size_t size;
+  int descriptors[3] = { -1, -1, -1 };
+  int res;
+
+  if (!(handle->serverFeatures & BRLAPI_FEATURE_SHAREDMEMORY) || (handle->addrfamily != PF_LOCAL)) {
+    brlapi_errno = BRLAPI_ERROR_OPNOTSUPP;
+    return -1;
+  }
+
+  /* keys mustn't be being read meanwhile */
+  pthread_mutex_lock(&handle->state_mutex);
+  res = (handle->state & STCONTROLLINGTTY) || handle->shared.region;
+  pthread_mutex_unlock(&handle->state_mutex);
+  if (res) {
+    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+    return -1;
+  }
+
+  if (!ringSize) ringSize = BRLAPI_SHARED_DEFRINGSIZE;
+  if (ringSize > 0X1000000) {
+    brlapi_errno = BRLAPI_ERROR_INVALID_PARAMETER;
+    return -1;
+  }
+  {
+    size_t power = BRLAPI_SHARED_MINRINGSIZE;
+    while (power < ringSize) power <<= 1;
+    ringSize = power;
+  }
+  dataOffset = BRLAPI_SHARED_ALIGN(sizeof(*header));
+  size = dataOffset + 2 * ringSize;
+
+  if ((descriptors[0] = memfd_create("brlapi", MFD_CLOEXEC|MFD_ALLOW_SEALING)) == -1) {
+    brlapi_errfun = "memfd_create";
+    goto libcerr;
+  }
+  if (ftruncate(descriptors[0], size) == -1) {
+    brlapi_errfun = "ftruncate";
+    goto libcerr;
+  }
+  if (fcntl(descriptors[0], F_ADD_SEALS, F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_SEAL) == -1) {
+    brlapi_errfun = "fcntl";
+    goto libcerr;
+  }
+  if ((descriptors[1] = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK)) == -1 ||
+      (descriptors[2] = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK)) == -1) {
+    brlapi_errfun = "eventfd";
+    goto libcerr;
+  }
+  if ((header = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, descriptors[0], 0)) == MAP_FAILED) {
+    brlapi_errfun = "mmap";
+    goto libcerr;
+  }
+
+  header->magic = BRLAPI_SHARED_MAGIC;
+  header->size = size;
+  header->toServer.head = header->toServer.tail = 0;
+  header->toServer.offset = dataOffset;
+  header->toServer.size = ringSize;
+  header->toClient.head = header->toClient.tail = 0;
+  header->toClient.offset = dataOffset + ringSize;
+  header->toClient.size = ringSize;
+  header->socketKeys = 0;
+
+  packetHeader.size = htonl(sizeof(packet));
+  packetHeader.type = htonl(BRLAPI_PACKET_SHAREDMEMORY);
+  packet.size = htonl(size);
+  iov[0].iov_base = &packetHeader;
+  iov[0].iov_len = sizeof(packetHeader);
+  iov[1].iov_base = &packet;
+  iov[1].iov_len = sizeof(packet);
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(descriptors));
+  memcpy(CMSG_DATA(cmsg), descriptors, sizeof(descriptors));
+
+  pthread_mutex_lock(&handle->req_mutex);
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  do {
+    res = sendmsg(handle->fileDescriptor, &msg, 0);
+  } while ((res == -1) && (errno == EINTR));
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  if (res != sizeof(packetHeader) + sizeof(packet)) {
+    pthread_mutex_unlock(&handle->req_mutex);
+    munmap(header, size);
+    brlapi_errfun = "sendmsg";
+    goto libcerr;
+  }
+  res = brlapi__waitForAck(handle);
+  if (res < 0) {
+    pthread_mutex_unlock(&handle->req_mutex);
+    munmap(header, size);
+    goto out;
+  }
+
+  /* the server has its own mapping of the region now */
+  close(descriptors[0]);
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  handle->shared.size = size;
+  handle->shared.requestEvent = descriptors[1];
+  handle->shared.keyEvent = descriptors[2];
+  brlapi_setSharedQueue(&handle->shared.requests, header, size, &header->toServer);
+  brlapi_setSharedQueue(&handle->shared.keys, header, size, &header->toClient);
+  handle->shared.region = header;
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  pthread_mutex_unlock(&handle->req_mutex);
+  return descriptors[2];
+
+libcerr:
+  brlapi_errno = BRLAPI_ERROR_LIBCERR;
+  brlapi_libcerrno = errno;
+out:
+  for (res=0; res<3; res++)
+    if (descriptors[res] != -1) close(descriptors[res]);
+  return -1;
+#else /* BRLAPI_SHARED_MEMORY */
+  brlapi_errno = BRLAPI_ERROR_OPNOTSUPP;
+  return -1;
+#endif /* BRLAPI_SHARED_MEMORY */
+}
+
+int BRLAPI_STDCALL brlapi_enableSharedMemory(size_t ringSize)
+{
+  return brlapi__enableSharedMemory(&defaultHandle, ringSize);
+}
+
+/* brlapi_sendPacket */
+/* Sends a request which doesn't get acknowledged, through the shared */
+/* memory ring if there is one and it has room, else through the socket */
+static int brlapi__sendPacket(brlapi_handle_t *handle, brlapi_packetType_t type, const void *buf, size_t size)
+{
+  int res;
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+#ifdef BRLAPI_SHARED_MEMORY
+  if (handle->shared.region && brlapi_putSharedRecord(&handle->shared.requests, type, buf, size)) {
+    res = eventfd_write(handle->shared.requestEvent, 1);
+    pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+    if (res == -1) {
+      brlapi_errfun = "eventfd_write";
+      brlapi_errno = BRLAPI_ERROR_LIBCERR;
+      brlapi_libcerrno = errno;
+    }
+    return res;
+  }
+#endif /* BRLAPI_SHARED_MEMORY */
+  res = brlapi_writePacket(handle->fileDescriptor, type, buf, size);
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  return res;
+}
+
 /* brlapi_getDriverSpecific */
 /* Switch to device specific mode */
 static int brlapi__getDriverSpecific(brlapi_handle_t *handle, const char *driver, brlapi_packetType_t type, int st)
@@ -992,33 +1494,17 @@ int BRLAPI_STDCALL brlapi_enterTtyMode(int tty, const char *how)
   return brlapi__enterTtyMode(&defaultHandle, tty, how);
 }
 
-/* Function : brlapi_enterTtyModeWithPath */
-/* Takes control of a tty path */
-int BRLAPI_STDCALL brlapi__enterTtyModeWithPath(brlapi_handle_t *handle, int *ttys, int nttys, const char *driverName)
+/* Function : buildTtyPathPacket */
+/* Fills an ENTERTTYMODE packet for the given tty path */
+/* Returns its size, or -1 on error */
+static ssize_t buildTtyPathPacket(brlapi_packet_t *packet, int *ttys, int nttys, const char *driverName)
 {
-  int res;
-  brlapi_packet_t packet;
   unsigned char *p;
-  uint32_t *nbTtys = (uint32_t*) &packet, *t = nbTtys+1;
+  uint32_t *nbTtys = (uint32_t*) packet, *t = nbTtys+1;
   char *ttytreepath,*ttytreepathstop;
   int ttypath;
   unsigned int n;
 
-  pthread_mutex_lock(&handle->state_mutex);
-  if ((handle->state & STCONTROLLINGTTY)) {
-    pthread_mutex_unlock(&handle->state_mutex);
-    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
-    return -1;
-  }
-
-  if (brlapi__getDisplaySize(handle, &handle->brlx, &handle->brly)<0) return -1;
-  
-  /* Clear key buffer before taking the tty, just in case... */
-  pthread_mutex_lock(&handle->read_mutex);
-  handle->keybuf_next = handle->keybuf_nb = 0;
-  pthread_mutex_unlock(&handle->read_mutex);
-
-  /* OK, Now we know where we are, so get the effective control of the terminal! */
   *nbTtys = 0;
   ttytreepath = getenv("WINDOWPATH");
   if (ttytreepath)
@@ -1043,7 +1529,37 @@ int BRLAPI_STDCALL brlapi__enterTtyModeWithPath(brlapi_handle_t *handle, int *tt
   p++;
   memcpy(p, driverName, n);
   p += n;
-  if ((res=brlapi__writePacketWaitForAck(handle,BRLAPI_PACKET_ENTERTTYMODE,&packet,(p-(unsigned char *)&packet))) == 0)
+  return p-(unsigned char *)packet;
+}
+
+/* Function : brlapi_enterTtyModeWithPath */
+/* Takes control of a tty path */
+int BRLAPI_STDCALL brlapi__enterTtyModeWithPath(brlapi_handle_t *handle, int *ttys, int nttys, const char *driverName)
+{
+  int res;
+  brlapi_packet_t packet;
+  ssize_t size;
+
+  pthread_mutex_lock(&handle->state_mutex);
+  if ((handle->state & STCONTROLLINGTTY)) {
+    pthread_mutex_unlock(&handle->state_mutex);
+    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+    return -1;
+  }
+
+  if (brlapi__getDisplaySize(handle, &handle->brlx, &handle->brly)<0) return -1;
+  
+  /* Clear key buffer before taking the tty, just in case... */
+  pthread_mutex_lock(&handle->read_mutex);
+  brlapi__clearKeyBuffer(handle);
+  pthread_mutex_unlock(&handle->read_mutex);
+
+  /* OK, Now we know where we are, so get the effective control of the terminal! */
+  if ((size = buildTtyPathPacket(&packet, ttys, nttys, driverName)) < 0) {
+    pthread_mutex_unlock(&handle->state_mutex);
+    return -1;
+  }
+  if ((res=brlapi__writePacketWaitForAck(handle,BRLAPI_PACKET_ENTERTTYMODE,&packet,size)) == 0)
     handle->state |= STCONTROLLINGTTY;
   pthread_mutex_unlock(&handle->state_mutex);
   return res;
@@ -1085,9 +1601,7 @@ int BRLAPI_STDCALL brlapi__setFocus(brlapi_handle_t *handle, int tty)
   uint32_t utty;
   int res;
   utty = htonl(tty);
-  pthread_mutex_lock(&handle->fileDescriptor_mutex);
-  res = brlapi_writePacket(handle->fileDescriptor, BRLAPI_PACKET_SETFOCUS, &utty, sizeof(utty));
-  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  res = brlapi__sendPacket(handle, BRLAPI_PACKET_SETFOCUS, &utty, sizeof(utty));
   return res;
 }
 
@@ -1218,9 +1732,7 @@ endcount:
   }
 
   wa->flags = htonl(wa->flags);
-  pthread_mutex_lock(&handle->fileDescriptor_mutex);
-  res = brlapi_writePacket(handle->fileDescriptor,BRLAPI_PACKET_WRITE,&packet,sizeof(wa->flags)+(p-&wa->data));
-  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  res = brlapi__sendPacket(handle,BRLAPI_PACKET_WRITE,&packet,sizeof(wa->flags)+(p-&wa->data));
   return res;
 }
 
@@ -1269,14 +1781,14 @@ int BRLAPI_STDCALL brlapi__writeDots(brlapi_handle_t *handle, const unsigned cha
   }
   {
     char text[size+1];
-    unsigned char andMask[size], orMask[size];
+    unsigned char andMask[size];
     memset(text, ' ', size);
     text[size] = 0;
     wa.regionBegin = 1;
     wa.regionSize = size;
     wa.text = text;
-    memcpy(orMask, dots, size);
-    wa.orMask = orMask;
+    /* brlapi_write only reads it */
+    wa.orMask = (unsigned char *) dots;
     memset(andMask, 0, size);
     wa.andMask = andMask;
     wa.cursor = 0;
@@ -1394,9 +1906,7 @@ int brlapi__write(brlapi_handle_t *handle, const brlapi_writeArguments_t *s)
   }
 send:
   wa->flags = htonl(wa->flags);
-  pthread_mutex_lock(&handle->fileDescriptor_mutex);
-  res = brlapi_writePacket(handle->fileDescriptor,BRLAPI_PACKET_WRITE,&packet,sizeof(wa->flags)+(p-&wa->data));
-  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  res = brlapi__sendPacket(handle,BRLAPI_PACKET_WRITE,&packet,sizeof(wa->flags)+(p-&wa->data));
   return res;
 }
 
@@ -1444,9 +1954,91 @@ static int packetReady(brlapi_handle_t *handle)
 #endif /* __MINGW32__ */
 }
 
-/* Function : brlapi_readKey */
-/* Reads a key from the braille keyboard */
-int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_keyCode_t *code)
+#ifdef BRLAPI_SHARED_MEMORY
+/* Function : brlapi_readSharedKey */
+/* Reads a key from the shared memory ring, or from the socket if the */
+/* server had to fall back to it; must be called with key_mutex locked */
+/* Keys still in the ring are older than those of the socket, so the ring */
+/* always goes first */
+static int brlapi__readSharedKey(brlapi_handle_t *handle, int block, brlapi_keyCode_t *code, uint64_t *timestamp)
+{
+  uint32_t buf[2];
+  brlapi_packetType_t type;
+  size_t size;
+  eventfd_t count;
+  fd_set set;
+  struct timeval timeout;
+  int fd = handle->fileDescriptor;
+  int event = handle->shared.keyEvent;
+  ssize_t res;
+
+  while (1) {
+    /* clear the event first so that a key queued meanwhile wakes us up */
+    eventfd_read(event, &count);
+    res = brlapi_getSharedRecord(&handle->shared.keys, &type, buf, sizeof(buf), &size);
+    if (res < 0) {
+      brlapi_errno = BRLAPI_ERROR_INVALID_PACKET;
+      return -1;
+    }
+    if (res > 0) {
+      if ((type != BRLAPI_PACKET_KEY) || (size != sizeof(buf))) continue;
+      /* the event was cleared for all of the keys, keep it up for the others */
+      pthread_mutex_lock(&handle->read_mutex);
+      if ((handle->shared.keys.ring->head != handle->shared.keys.ring->tail) || handle->keybuf_nb)
+        eventfd_write(event, 1);
+      pthread_mutex_unlock(&handle->read_mutex);
+      break;
+    }
+
+    /* keys may have been buffered while other requests were waiting */
+    pthread_mutex_lock(&handle->read_mutex);
+    res = brlapi__unbufferKey(handle, code, timestamp);
+    pthread_mutex_unlock(&handle->read_mutex);
+    if (res) return 1;
+
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    FD_SET(event, &set);
+    memset(&timeout, 0, sizeof(timeout));
+    res = select(MAX(fd, event)+1, &set, NULL, NULL, block? NULL: &timeout);
+    if (res < 0) {
+      if (errno == EINTR) continue;
+      brlapi_errfun = "select";
+      brlapi_errno = BRLAPI_ERROR_LIBCERR;
+      brlapi_libcerrno = errno;
+      return -1;
+    }
+    if (res == 0) return 0;
+    if (FD_ISSET(event, &set)) continue;
+
+    if (FD_ISSET(fd, &set)) {
+      res = brlapi__waitForPacket(handle, BRLAPI_PACKET_KEY, buf, sizeof(buf), 0);
+      if (res >= 0) {
+        pthread_mutex_lock(&handle->read_mutex);
+        brlapi__countSocketKeys(handle, 1);
+        pthread_mutex_unlock(&handle->read_mutex);
+        break;
+      }
+      if (res != -3) return -1;
+      if (!block) {
+        /* a batch of keys may have come instead */
+        pthread_mutex_lock(&handle->read_mutex);
+        res = brlapi__unbufferKey(handle, code, timestamp);
+        pthread_mutex_unlock(&handle->read_mutex);
+        return res;
+      }
+    }
+  }
+
+  *code = ((brlapi_keyCode_t)ntohl(buf[0]) << 32) | ntohl(buf[1]);
+  if (timestamp) *timestamp = brlapi_getTime();
+  return 1;
+}
+#endif /* BRLAPI_SHARED_MEMORY */
+
+/* Function : brlapi_readKeyWithTimestamp */
+/* Reads a key from the braille keyboard, along with when it was pressed */
+int BRLAPI_STDCALL brlapi__readKeyWithTimestamp(brlapi_handle_t *handle, int block, brlapi_keyCode_t *code, uint64_t *timestamp)
 {
   ssize_t res;
   uint32_t buf[2];
@@ -1459,15 +2051,20 @@ int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_ke
   }
   pthread_mutex_unlock(&handle->state_mutex);
 
-  pthread_mutex_lock(&handle->read_mutex);
-  if (handle->keybuf_nb>0) {
-    *code=handle->keybuf[handle->keybuf_next];
-    handle->keybuf_next=(handle->keybuf_next+1)%BRL_KEYBUF_SIZE;
-    handle->keybuf_nb--;
-    pthread_mutex_unlock(&handle->read_mutex);
-    return 1;
+#ifdef BRLAPI_SHARED_MEMORY
+  if (handle->shared.region) {
+    /* buffered keys mustn't overtake those of the ring */
+    pthread_mutex_lock(&handle->key_mutex);
+    res = brlapi__readSharedKey(handle, block, code, timestamp);
+    pthread_mutex_unlock(&handle->key_mutex);
+    return res;
   }
+#endif /* BRLAPI_SHARED_MEMORY */
+
+  pthread_mutex_lock(&handle->read_mutex);
+  res = brlapi__unbufferKey(handle, code, timestamp);
   pthread_mutex_unlock(&handle->read_mutex);
+  if (res) return 1;
 
   pthread_mutex_lock(&handle->key_mutex);
   if (!block) {
@@ -1480,6 +2077,17 @@ int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_ke
     }
   }
   res=brlapi__waitForPacket(handle,BRLAPI_PACKET_KEY, buf, sizeof(buf), 0);
+  if (res == -3) {
+    /* a batch of keys may have come instead */
+    int got;
+    pthread_mutex_lock(&handle->read_mutex);
+    got = brlapi__unbufferKey(handle, code, timestamp);
+    pthread_mutex_unlock(&handle->read_mutex);
+    if (got) {
+      pthread_mutex_unlock(&handle->key_mutex);
+      return 1;
+    }
+  }
   pthread_mutex_unlock(&handle->key_mutex);
   if (res == -3) {
     if (!block) return 0;
@@ -1490,14 +2098,104 @@ int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_ke
   }
   if (res < 0) return -1;
   *code = ((brlapi_keyCode_t)ntohl(buf[0]) << 32) | ntohl(buf[1]);
+  if (timestamp) *timestamp = brlapi_getTime();
   return 1;
 }
 
+int BRLAPI_STDCALL brlapi_readKeyWithTimestamp(int block, brlapi_keyCode_t *code, uint64_t *timestamp)
+{
+  return brlapi__readKeyWithTimestamp(&defaultHandle, block, code, timestamp);
+}
+
+/* Function : brlapi_readKey */
+/* Reads a key from the braille keyboard */
+int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_keyCode_t *code)
+{
+  return brlapi__readKeyWithTimestamp(handle, block, code, NULL);
+}
+
 int BRLAPI_STDCALL brlapi_readKey(int block, brlapi_keyCode_t *code)
 {
   return brlapi__readKey(&defaultHandle, block, code) ;
 }
 
+/* Function : brlapi_setKeyBatching */
+/* Lets the server hold key presses back for up to delay milliseconds */
+/* and send them in batches; a negative delay stops batching */
+int BRLAPI_STDCALL brlapi__setKeyBatching(brlapi_handle_t *handle, int delay)
+{
+  brlapi_keyBatchingPacket_t packet;
+
+  if (!(handle->serverFeatures & BRLAPI_FEATURE_KEYBATCHING)) {
+    brlapi_errno = BRLAPI_ERROR_OPNOTSUPP;
+    return -1;
+  }
+  if (delay > BRLAPI_KEYBATCHING_MAXDELAY) {
+    brlapi_errno = BRLAPI_ERROR_INVALID_PARAMETER;
+    return -1;
+  }
+  packet.delay = htonl(delay<0? BRLAPI_KEYBATCHING_OFF: (uint32_t)delay);
+  return brlapi__writePacketWaitForAck(handle, BRLAPI_PACKET_KEYBATCHING, &packet, sizeof(packet));
+}
+
+int BRLAPI_STDCALL brlapi_setKeyBatching(int delay)
+{
+  return brlapi__setKeyBatching(&defaultHandle, delay);
+}
+
+/* Function : brlapi_getKeyFileDescriptor */
+int BRLAPI_STDCALL brlapi__getKeyFileDescriptor(brlapi_handle_t *handle)
+{
+#ifdef __MINGW32__
+  brlapi_errno = BRLAPI_ERROR_OPNOTSUPP;
+  return -1;
+#else /* __MINGW32__ */
+  int res;
+  pthread_mutex_lock(&handle->read_mutex);
+#ifdef BRLAPI_SHARED_MEMORY
+  if (handle->shared.region) {
+    /* already kept readable while there are keys, see brlapi_signalBufferedKeys */
+    res = handle->shared.keyEvent;
+    pthread_mutex_unlock(&handle->read_mutex);
+    return res;
+  }
+#endif /* BRLAPI_SHARED_MEMORY */
+  if (handle->keyPipe[0] == -1) {
+    unsigned int i;
+    if (pipe(handle->keyPipe) == -1) {
+      brlapi_errfun = "pipe";
+      goto libcerr;
+    }
+    for (i=0; i<2; i++) {
+      if (fcntl(handle->keyPipe[i], F_SETFD, FD_CLOEXEC) == -1 ||
+          fcntl(handle->keyPipe[i], F_SETFL, O_NONBLOCK) == -1) {
+        brlapi_errfun = "fcntl";
+        close(handle->keyPipe[0]);
+        close(handle->keyPipe[1]);
+        handle->keyPipe[0] = handle->keyPipe[1] = -1;
+        goto libcerr;
+      }
+    }
+    /* account for the keys which are already there */
+    brlapi__signalBufferedKeys(handle, 0);
+  }
+  res = handle->keyPipe[0];
+  pthread_mutex_unlock(&handle->read_mutex);
+  return res;
+
+libcerr:
+  brlapi_errno = BRLAPI_ERROR_LIBCERR;
+  brlapi_libcerrno = errno;
+  pthread_mutex_unlock(&handle->read_mutex);
+  return -1;
+#endif /* __MINGW32__ */
+}
+
+int BRLAPI_STDCALL brlapi_getKeyFileDescriptor(void)
+{
+  return brlapi__getKeyFileDescriptor(&defaultHandle);
+}
+
 typedef struct {
   brlapi_keyCode_t code;
   const char *name;
@@ -1739,6 +2437,310 @@ int BRLAPI_STDCALL brlapi_ignoreKeys(brlapi_rangeType_t r, const brlapi_keyCode_
   return brlapi__ignoreKeys(&defaultHandle, r, code, n);
 }
 
+/* Function : brlapi_reserveAsync */
+/* Allocates a token for an asynchronous request made of count packets */
+/* must be called with req_mutex locked */
+static int brlapi__reserveAsync(brlapi_handle_t *handle, unsigned int count, brlapi_token_t *token)
+{
+  int res = 0;
+  pthread_mutex_lock(&handle->read_mutex);
+  if (handle->pending_nb + handle->completed_nb + count > BRL_MAXPENDING) {
+    brlapi_errfun = "brlapi_reserveAsync";
+    brlapi_errno = BRLAPI_ERROR_LIBCERR;
+    brlapi_libcerrno = EAGAIN;
+    res = -1;
+  } else {
+    if (!++handle->lastToken) ++handle->lastToken;
+    *token = handle->lastToken;
+  }
+  pthread_mutex_unlock(&handle->read_mutex);
+  return res;
+}
+
+/* Function : brlapi_sendAsync */
+/* Sends a packet whose answer will be recorded by brlapi_completeRequest */
+/* must be called with req_mutex locked, after brlapi_reserveAsync */
+static int brlapi__sendAsync(brlapi_handle_t *handle, brlapi_token_t token, int report, brlapi_packetType_t type, const void *buf, size_t size)
+{
+  brlapi_pendingRequest_t *request;
+  int res;
+
+  /* queue it first, the answer may be read by another thread right away */
+  pthread_mutex_lock(&handle->read_mutex);
+  request = &handle->pending[(handle->pending_next+handle->pending_nb++)%BRL_MAXPENDING];
+  request->token = token;
+  request->type = type;
+  request->report = report;
+  pthread_mutex_unlock(&handle->read_mutex);
+
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  res = brlapi_writePacket(handle->fileDescriptor, type, buf, size);
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+
+  if (res < 0) {
+    /* not sent, hence never answered */
+    pthread_mutex_lock(&handle->read_mutex);
+    handle->pending_nb--;
+    pthread_mutex_unlock(&handle->read_mutex);
+  }
+  return res;
+}
+
+/* Function : brlapi_getCompletionFileDescriptor */
+int BRLAPI_STDCALL brlapi__getCompletionFileDescriptor(brlapi_handle_t *handle)
+{
+#ifdef __MINGW32__
+  brlapi_errno = BRLAPI_ERROR_OPNOTSUPP;
+  return -1;
+#else /* __MINGW32__ */
+  int res;
+  pthread_mutex_lock(&handle->read_mutex);
+  if (handle->completionPipe[0] == -1) {
+    unsigned int i;
+    if (pipe(handle->completionPipe) == -1) {
+      brlapi_errfun = "pipe";
+      goto libcerr;
+    }
+    for (i=0; i<2; i++) {
+      if (fcntl(handle->completionPipe[i], F_SETFD, FD_CLOEXEC) == -1 ||
+          fcntl(handle->completionPipe[i], F_SETFL, O_NONBLOCK) == -1) {
+        brlapi_errfun = "fcntl";
+        close(handle->completionPipe[0]);
+        close(handle->completionPipe[1]);
+        handle->completionPipe[0] = handle->completionPipe[1] = -1;
+        goto libcerr;
+      }
+    }
+    /* account for the completions which are already there */
+    for (i=0; i<handle->completed_nb; i++)
+      if (write(handle->completionPipe[1], "", 1) == -1) break;
+  }
+  res = handle->completionPipe[0];
+  pthread_mutex_unlock(&handle->read_mutex);
+  return res;
+
+libcerr:
+  brlapi_errno = BRLAPI_ERROR_LIBCERR;
+  brlapi_libcerrno = errno;
+  pthread_mutex_unlock(&handle->read_mutex);
+  return -1;
+#endif /* __MINGW32__ */
+}
+
+int BRLAPI_STDCALL brlapi_getCompletionFileDescriptor(void)
+{
+  return brlapi__getCompletionFileDescriptor(&defaultHandle);
+}
+
+/* Function : brlapi_getCompletion */
+int BRLAPI_STDCALL brlapi__getCompletion(brlapi_handle_t *handle, brlapi_completion_t *completion)
+{
+  ssize_t res;
+
+  while (1) {
+    int reading;
+    unsigned int pending;
+
+    pthread_mutex_lock(&handle->read_mutex);
+    if (handle->completed_nb) {
+      brlapi_completedRequest_t *completed = &handle->completed[handle->completed_next];
+      brlapi_packetType_t type = completed->type;
+      char byte;
+
+      completion->token = completed->token;
+      completion->error = completed->error;
+      handle->completed_next = (handle->completed_next+1)%BRL_MAXPENDING;
+      handle->completed_nb--;
+      if (handle->completionPipe[0] != -1)
+        if (read(handle->completionPipe[0], &byte, 1) == -1) {}
+      pthread_mutex_unlock(&handle->read_mutex);
+
+      if (type==BRLAPI_PACKET_ENTERTTYMODE && completion->error!=BRLAPI_ERROR_SUCCESS) {
+        /* we didn't get the tty after all */
+        pthread_mutex_lock(&handle->state_mutex);
+        handle->state &= ~STCONTROLLINGTTY;
+        pthread_mutex_unlock(&handle->state_mutex);
+      }
+      return 1;
+    }
+    reading = handle->reading;
+    pending = handle->pending_nb;
+    pthread_mutex_unlock(&handle->read_mutex);
+
+    /* whoever is reading will record the answers */
+    if (!pending || reading) return 0;
+
+    if ((res = packetReady(handle)) <= 0) {
+      if (res < 0) {
+        brlapi_errfun = "packetReady";
+        brlapi_errno = BRLAPI_ERROR_LIBCERR;
+        brlapi_libcerrno = errno;
+      }
+      return res;
+    }
+
+    /* no packet has type 0, so anything read gets dispatched */
+    res = brlapi__waitForPacket(handle, 0, NULL, 0, 0);
+    if (res != -3) return -1;
+  }
+}
+
+int BRLAPI_STDCALL brlapi_getCompletion(brlapi_completion_t *completion)
+{
+  return brlapi__getCompletion(&defaultHandle, completion);
+}
+
+/* Function : brlapi_enterTtyModeWithPathAsync */
+int BRLAPI_STDCALL brlapi__enterTtyModeWithPathAsync(brlapi_handle_t *handle, int *ttys, int nttys, const char *driverName, brlapi_token_t *token)
+{
+  brlapi_packet_t packet;
+  ssize_t size;
+  int res = -1;
+
+  if ((size = buildTtyPathPacket(&packet, ttys, nttys, driverName)) < 0) return -1;
+
+  pthread_mutex_lock(&handle->state_mutex);
+  if ((handle->state & STCONTROLLINGTTY)) {
+    pthread_mutex_unlock(&handle->state_mutex);
+    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+    return -1;
+  }
+
+  pthread_mutex_lock(&handle->req_mutex);
+  if (brlapi__reserveAsync(handle, 2, token) < 0) goto out;
+
+  pthread_mutex_lock(&handle->read_mutex);
+  brlapi__clearKeyBuffer(handle);
+  pthread_mutex_unlock(&handle->read_mutex);
+
+  /* the display size is recorded when its answer comes */
+  if (brlapi__sendAsync(handle, *token, 0, BRLAPI_PACKET_GETDISPLAYSIZE, NULL, 0) < 0) goto out;
+  if (brlapi__sendAsync(handle, *token, 1, BRLAPI_PACKET_ENTERTTYMODE, &packet, size) < 0) {
+    brlapi__failAsync(handle, *token, BRLAPI_PACKET_ENTERTTYMODE);
+    res = 0;
+    goto out;
+  }
+
+  /* taken until the completion tells otherwise, so that keys get buffered */
+  handle->state |= STCONTROLLINGTTY;
+  res = 0;
+
+out:
+  pthread_mutex_unlock(&handle->req_mutex);
+  pthread_mutex_unlock(&handle->state_mutex);
+  return res;
+}
+
+int BRLAPI_STDCALL brlapi_enterTtyModeWithPathAsync(int *ttys, int nttys, const char *driverName, brlapi_token_t *token)
+{
+  return brlapi__enterTtyModeWithPathAsync(&defaultHandle, ttys, nttys, driverName, token);
+}
+
+/* Function : brlapi_enterTtyModeAsync */
+int BRLAPI_STDCALL brlapi__enterTtyModeAsync(brlapi_handle_t *handle, int tty, const char *driverName, brlapi_token_t *token)
+{
+  if (tty<0) tty = getControllingTty();
+  if (tty<0) { brlapi_errno=BRLAPI_ERROR_UNKNOWNTTY; return -1; }
+
+  if (brlapi__enterTtyModeWithPathAsync(handle, &tty, 1, driverName, token)) return -1;
+
+  return tty;
+}
+
+int BRLAPI_STDCALL brlapi_enterTtyModeAsync(int tty, const char *driverName, brlapi_token_t *token)
+{
+  return brlapi__enterTtyModeAsync(&defaultHandle, tty, driverName, token);
+}
+
+/* Function : brlapi_leaveTtyModeAsync */
+int BRLAPI_STDCALL brlapi__leaveTtyModeAsync(brlapi_handle_t *handle, brlapi_token_t *token)
+{
+  int res = -1;
+  pthread_mutex_lock(&handle->state_mutex);
+  if (!(handle->state & STCONTROLLINGTTY)) {
+    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+    goto out;
+  }
+  pthread_mutex_lock(&handle->req_mutex);
+  if (brlapi__reserveAsync(handle, 1, token) == 0 &&
+      brlapi__sendAsync(handle, *token, 1, BRLAPI_PACKET_LEAVETTYMODE, NULL, 0) == 0) {
+    handle->brlx = 0; handle->brly = 0;
+    handle->state &= ~STCONTROLLINGTTY;
+    res = 0;
+  }
+  pthread_mutex_unlock(&handle->req_mutex);
+out:
+  pthread_mutex_unlock(&handle->state_mutex);
+  return res;
+}
+
+int BRLAPI_STDCALL brlapi_leaveTtyModeAsync(brlapi_token_t *token)
+{
+  return brlapi__leaveTtyModeAsync(&defaultHandle, token);
+}
+
+/* Function : ignore_accept_key_ranges_async */
+/* Same as ignore_accept_key_ranges, without waiting for the answers */
+static int ignore_accept_key_ranges_async(brlapi_handle_t *handle, int what, brlapi_range_t ranges[], unsigned int n, brlapi_token_t *token)
+{
+  const unsigned int perPacket = BRLAPI_MAXPACKETSIZE / (2*sizeof(brlapi_keyCode_t));
+  uint32_t ints[n][4];
+  unsigned int i, remaining, todo;
+  int res = 0;
+
+  if (!n) {
+    brlapi_errno = BRLAPI_ERROR_INVALID_PARAMETER;
+    return -1;
+  }
+
+  for (i=0; i<n; i++) {
+    ints[i][0] = htonl(ranges[i].first >> 32);
+    ints[i][1] = htonl(ranges[i].first & 0xffffffff);
+    ints[i][2] = htonl(ranges[i].last >> 32);
+    ints[i][3] = htonl(ranges[i].last & 0xffffffff);
+  };
+
+  pthread_mutex_lock(&handle->req_mutex);
+  if (brlapi__reserveAsync(handle, (n+perPacket-1)/perPacket, token) < 0) {
+    res = -1;
+  } else {
+    for (remaining = n; remaining; remaining -= todo) {
+      todo = remaining;
+      if (todo > perPacket) todo = perPacket;
+      /* only the last packet's completion is reported, with any former error */
+      if (brlapi__sendAsync(handle, *token, todo == remaining, (what ? BRLAPI_PACKET_ACCEPTKEYRANGES : BRLAPI_PACKET_IGNOREKEYRANGES), &ints[n-remaining], todo*2*sizeof(brlapi_keyCode_t)) < 0) {
+        if (remaining == n) res = -1;
+        else brlapi__failAsync(handle, *token, (what ? BRLAPI_PACKET_ACCEPTKEYRANGES : BRLAPI_PACKET_IGNOREKEYRANGES));
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock(&handle->req_mutex);
+  return res;
+}
+
+/* Function : brlapi_acceptKeyRangesAsync */
+int BRLAPI_STDCALL brlapi__acceptKeyRangesAsync(brlapi_handle_t *handle, brlapi_range_t ranges[], unsigned int n, brlapi_token_t *token)
+{
+  return ignore_accept_key_ranges_async(handle, !0, ranges, n, token);
+}
+
+int BRLAPI_STDCALL brlapi_acceptKeyRangesAsync(brlapi_range_t ranges[], unsigned int n, brlapi_token_t *token)
+{
+  return brlapi__acceptKeyRangesAsync(&defaultHandle, ranges, n, token);
+}
+
+/* Function : brlapi_ignoreKeyRangesAsync */
+int BRLAPI_STDCALL brlapi__ignoreKeyRangesAsync(brlapi_handle_t *handle, brlapi_range_t ranges[], unsigned int n, brlapi_token_t *token)
+{
+  return ignore_accept_key_ranges_async(handle, 0, ranges, n, token);
+}
+
+int BRLAPI_STDCALL brlapi_ignoreKeyRangesAsync(brlapi_range_t ranges[], unsigned int n, brlapi_token_t *token)
+{
+  return brlapi__ignoreKeyRangesAsync(&defaultHandle, ranges, n, token);
+}
+
 /* Error code handling */
 
 /* brlapi_errlist: error messages */
@@ -30,6 +30,7 @@
 #include <io.h>
 #else /* __MINGW32__ */
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -43,6 +44,12 @@
 #define PF_LOCAL PF_UNIX
 #endif /* !defined(PF_LOCAL) && defined(PF_UNIX) */
 
+#if defined(PF_LOCAL) && defined(SCM_RIGHTS) && defined(HAVE_MEMFD_CREATE) && defined(HAVE_SYS_EVENTFD_H)
+#define BRLAPI_SHARED_MEMORY
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#endif /* shared memory rings */
+
 #ifndef MIN
 #define MIN(a, b) (((a) < (b))? (a): (b))
 #endif /* MIN */
@@ -60,19 +67,15 @@
   brlapi_libcerrno = errno; \
   brlapi_errfun = function;
 
+#ifdef __MINGW32__
 /* brlapi_writeFile */
 /* Writes a buffer to a file */
 static ssize_t brlapi_writeFile(brlapi_fileDescriptor fd, const void *buffer, size_t size)
 {
   const unsigned char *buf = buffer;
   size_t n;
-#ifdef __MINGW32__
   DWORD res=0;
-#else /* __MINGW32__ */
-  ssize_t res=0;
-#endif /* __MINGW32__ */
   for (n=0;n<size;n+=res) {
-#ifdef __MINGW32__
     OVERLAPPED overl = {0, 0, {{0, 0}}, CreateEvent(NULL, TRUE, FALSE, NULL)};
     if ((!WriteFile(fd,buf+n,size-n,&res,&overl)
       && GetLastError() != ERROR_IO_PENDING) ||
@@ -83,20 +86,48 @@ static ssize_t brlapi_writeFile(brlapi_fileDescriptor fd, const void *buffer, si
       return -1;
     }
     CloseHandle(overl.hEvent);
+  }
+  return n;
+}
 #else /* __MINGW32__ */
-    res=send(fd,buf+n,size-n,0);
-    if ((res<0) &&
-        (errno!=EINTR) &&
+/* brlapi_writeFileVector */
+/* Writes a set of buffers to a file, with one system call unless it has to */
+/* be restarted; the vector is updated along the way */
+static ssize_t brlapi_writeFileVector(brlapi_fileDescriptor fd, struct iovec *iov, int count)
+{
+  struct msghdr msg;
+  size_t n = 0;
+  ssize_t res;
+
+  memset(&msg, 0, sizeof(msg));
+  while (count) {
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    res = sendmsg(fd, &msg, 0);
+    if (res<0) {
+      if ((errno!=EINTR) &&
 #ifdef EWOULDBLOCK
-        (errno!=EWOULDBLOCK) &&
+          (errno!=EWOULDBLOCK) &&
 #endif /* EWOULDBLOCK */
-        (errno!=EAGAIN)) { /* EAGAIN shouldn't happen, but who knows... */
-      return res;
+          (errno!=EAGAIN)) { /* EAGAIN shouldn't happen, but who knows... */
+        return res;
+      }
+      continue;
+    }
+    n += res;
+    while (count && (res >= iov->iov_len)) {
+      res -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count) {
+      iov->iov_base = (unsigned char *) iov->iov_base + res;
+      iov->iov_len -= res;
     }
-#endif /* __MINGW32__ */
   }
   return n;
 }
+#endif /* __MINGW32__ */
 
 /* brlapi_readFile */
 /* Reads a buffer from a file */
@@ -150,6 +181,7 @@ ssize_t BRLAPI(writePacket)(brlapi_fileDescriptor fd, brlapi_packetType_t type,
   uint32_t header[2] = { htonl(size), htonl(type) };
   ssize_t res;
 
+#ifdef __MINGW32__
   /* first send packet header (size+type) */
   if ((res=brlapi_writeFile(fd,&header[0],sizeof(header)))<0) {
     LibcError("write in writePacket");
@@ -162,6 +194,20 @@ ssize_t BRLAPI(writePacket)(brlapi_fileDescriptor fd, brlapi_packetType_t type,
       LibcError("write in writePacket");
       return res;
     }
+#else /* __MINGW32__ */
+  /* packet header (size+type) and eventually data, in one go so that they */
+  /* end up in the same segment */
+  struct iovec iov[2];
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = (void *) buf;
+  iov[1].iov_len = buf? size: 0;
+
+  if ((res=brlapi_writeFileVector(fd,iov,2))<0) {
+    LibcError("write in writePacket");
+    return res;
+  }
+#endif /* __MINGW32__ */
 
   return 0;
 }
@@ -229,6 +275,119 @@ ssize_t BRLAPI(readPacket)(brlapi_fileDescriptor fd, brlapi_packetType_t *packet
   return BRLAPI(readPacketContent)(fd, res, buf, size);
 }
 
+#ifdef BRLAPI_SHARED_MEMORY
+/* Both ends of a shared memory ring */
+/* The data area size is copied out of the shared region so that the peer */
+/* can't change it under our feet */
+typedef struct {
+  brlapi_sharedRing_t *ring;
+  unsigned char *data;
+  uint32_t size;
+} brlapi_sharedQueue_t;
+
+#define BRLAPI_SHARED_ALIGN(size) (((size) + 3) & ~((size_t) 3))
+
+/* brlapi_putSharedRecord */
+/* Appends a packet to a shared memory ring */
+/* Returns 1 on success, 0 if the ring is full */
+static int BRLAPI(putSharedRecord)(brlapi_sharedQueue_t *queue, brlapi_packetType_t type, const void *buf, size_t size)
+{
+  volatile brlapi_sharedRing_t *ring = queue->ring;
+  uint32_t head = ring->head;
+  uint32_t tail = ring->tail;
+  uint32_t offset = head & (queue->size - 1);
+  uint32_t contiguous = queue->size - offset;
+  uint32_t needed = BRLAPI_HEADERSIZE + BRLAPI_SHARED_ALIGN(size);
+  uint32_t skip = (contiguous < needed)? contiguous: 0;
+  brlapi_header_t *header;
+
+  if ((head - tail) + skip + needed > queue->size) return 0;
+
+  if (skip) {
+    if (skip >= BRLAPI_HEADERSIZE) {
+      header = (brlapi_header_t *) (queue->data + offset);
+      header->size = skip - BRLAPI_HEADERSIZE;
+      header->type = 0;
+    }
+    head += skip;
+    offset = 0;
+  }
+
+  header = (brlapi_header_t *) (queue->data + offset);
+  header->size = size;
+  header->type = type;
+  if (size) memcpy(header+1, buf, size);
+
+  __sync_synchronize();
+  ring->head = head + needed;
+  return 1;
+}
+
+/* brlapi_getSharedRecord */
+/* Removes the oldest packet from a shared memory ring */
+/* Returns 1 if a packet was read, 0 if the ring is empty, */
+/* -1 if the ring is corrupted */
+static int BRLAPI(getSharedRecord)(brlapi_sharedQueue_t *queue, brlapi_packetType_t *type, void *buf, size_t bufSize, size_t *size)
+{
+  volatile brlapi_sharedRing_t *ring = queue->ring;
+
+  while (1) {
+    uint32_t tail = ring->tail;
+    uint32_t used = ring->head - tail;
+    uint32_t offset = tail & (queue->size - 1);
+    uint32_t contiguous = queue->size - offset;
+    uint32_t length;
+    brlapi_header_t header;
+
+    if (!used) return 0;
+    if ((used > queue->size) || (used & 3)) return -1;
+    __sync_synchronize();
+
+    if (contiguous < BRLAPI_HEADERSIZE) {
+      length = contiguous;
+    } else {
+      memcpy(&header, queue->data + offset, sizeof(header));
+      if (header.size > contiguous - BRLAPI_HEADERSIZE) return -1;
+      length = BRLAPI_HEADERSIZE + BRLAPI_SHARED_ALIGN(header.size);
+      if (length > used) return -1;
+
+      if (header.type) {
+        if (header.size > bufSize) return -1;
+        if (header.size) memcpy(buf, queue->data + offset + BRLAPI_HEADERSIZE, header.size);
+        *type = header.type;
+        *size = header.size;
+        __sync_synchronize();
+        ring->tail = tail + length;
+        return 1;
+      }
+    }
+
+    ring->tail = tail + length;
+  }
+}
+
+/* brlapi_setSharedQueue */
+/* Locates a ring within a mapped shared memory region */
+/* Returns 0 on success, -1 if the ring doesn't fit in the region */
+static int BRLAPI(setSharedQueue)(brlapi_sharedQueue_t *queue, void *region, size_t regionSize, brlapi_sharedRing_t *ring)
+{
+  uint32_t offset = ring->offset;
+  uint32_t size = ring->size;
+
+  if (size < BRLAPI_SHARED_MINRINGSIZE) return -1;
+  if (size & (size - 1)) return -1;
+  if (offset & 3) return -1;
+  if (offset < sizeof(brlapi_sharedMemoryHeader_t)) return -1;
+  if (offset > regionSize) return -1;
+  if (size > regionSize - offset) return -1;
+
+  queue->ring = ring;
+  queue->data = (unsigned char *) region + offset;
+  queue->size = size;
+  return 0;
+}
+#endif /* BRLAPI_SHARED_MEMORY */
+
 /* Function : brlapi_loadAuthKey */
 /* Loads an authorization key from the given file */
 /* It is stored in auth, and its size in authLength */
@@ -339,6 +498,9 @@ static const brlapi_packetTypeEntry_t brlapi_packetTypeTable[] = {
   { BRLAPI_PACKET_PACKET, "Packet" },
   { BRLAPI_PACKET_SUSPENDDRIVER, "SuspendDriver" },
   { BRLAPI_PACKET_RESUMEDRIVER, "ResumeDriver" },
+  { BRLAPI_PACKET_SHAREDMEMORY, "SharedMemory" },
+  { BRLAPI_PACKET_KEYBATCHING, "KeyBatching" },
+  { BRLAPI_PACKET_KEYS, "Keys" },
   { BRLAPI_PACKET_ACK, "Ack" },
   { BRLAPI_PACKET_ERROR, "Error" },
   { BRLAPI_PACKET_EXCEPTION, "Exception" },
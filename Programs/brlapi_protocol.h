@@ -74,6 +74,9 @@ extern "C" {
 #define BRLAPI_PACKET_EXCEPTION       'E'   /**< Exception                   */
 #define BRLAPI_PACKET_SUSPENDDRIVER   'S'   /**< Suspend driver              */
 #define BRLAPI_PACKET_RESUMEDRIVER    'R'   /**< Resume driver               */
+#define BRLAPI_PACKET_SHAREDMEMORY    'M'   /**< Shared memory rings         */
+#define BRLAPI_PACKET_KEYBATCHING     'b'   /**< Batch key presses           */
+#define BRLAPI_PACKET_KEYS            'K'   /**< Batch of braille keys       */
 
 /** Magic number to give when sending a BRLPACKET_ENTERRAWMODE or BRLPACKET_SUSPEND packet */
 #define BRLAPI_DEVICE_MAGIC (0xdeadbeefL)
@@ -90,8 +93,13 @@ typedef struct {
 /** Structure of version packets */
 typedef struct {
   uint32_t protocolVersion;
+  uint32_t features; /** Only sent by servers, see BRLAPI_FEATURE_* */
 } brlapi_versionPacket_t;
 
+/** Features which the server may announce after its protocol version */
+#define BRLAPI_FEATURE_SHAREDMEMORY 0X01 /**< Shared memory rings for local clients */
+#define BRLAPI_FEATURE_KEYBATCHING 0X02 /**< Batches of key presses */
+
 /** Structure of authorization packets */
 typedef struct {
   uint32_t type;
@@ -135,6 +143,70 @@ typedef struct {
   unsigned char data; /** Fields in the same order as flag weight */
 } brlapi_writeArgumentsPacket_t;
 
+/** Structure of shared memory packets
+ *
+ * The memory file descriptor and the two event file descriptors (client to
+ * server, then server to client) are passed along as SCM_RIGHTS ancillary data.
+ */
+typedef struct {
+  uint32_t size; /** Size of the shared memory region */
+} brlapi_sharedMemoryPacket_t;
+
+/** Structure of key batching packets */
+typedef struct {
+  uint32_t delay; /** Milliseconds a key may be held back, or BRLAPI_KEYBATCHING_OFF */
+} brlapi_keyBatchingPacket_t;
+
+/** Value of the delay for going back to a packet per key press */
+#define BRLAPI_KEYBATCHING_OFF 0XFFFFFFFFU
+
+/** Longest delay a key may be held back for */
+#define BRLAPI_KEYBATCHING_MAXDELAY 1000
+
+/** A key press within a batch, BRLAPI_PACKET_KEYS packets being arrays of them */
+typedef struct {
+  uint32_t code[2]; /** Key code, most significant half first */
+  uint32_t age; /** Milliseconds between the key press and the sending of the batch */
+} brlapi_batchedKey_t;
+
+/** Magic number at the start of a shared memory region */
+#define BRLAPI_SHARED_MAGIC (0X42534852L)
+
+/** Minimum and default sizes of each ring of a shared memory region */
+#define BRLAPI_SHARED_MINRINGSIZE 0X1000
+#define BRLAPI_SHARED_DEFRINGSIZE 0X10000
+
+/** Control words of a single producer, single consumer ring
+ *
+ * \e head and \e tail are free-running byte counters, the data area size is a
+ * power of two. Records are a brlapi_header_t in host byte order followed by
+ * the packet data padded to a multiple of 4 bytes. A record never wraps:
+ * the unused end of the data area is skipped, with a record of type 0 when
+ * it is large enough to hold a header.
+ */
+typedef struct {
+  uint32_t head; /** Written by the producer */
+  uint32_t tail; /** Written by the consumer */
+  uint32_t offset; /** Offset of the data area from the start of the region */
+  uint32_t size; /** Size of the data area */
+} brlapi_sharedRing_t;
+
+/** Header of a shared memory region
+ *
+ * When the key ring is full the server sends keys through the socket
+ * instead, and the client returns the keys of the ring before those of the
+ * socket. The server only goes back to the ring once it is empty and
+ * \e socketKeys says that the client has taken every key sent through the
+ * socket, so that keys are always returned in the order they were pressed.
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t size; /** Size of the whole region */
+  brlapi_sharedRing_t toServer; /** Write and focus requests */
+  brlapi_sharedRing_t toClient; /** Key events */
+  uint32_t socketKeys; /** Keys taken from the socket, written by the client */
+} brlapi_sharedMemoryHeader_t;
+
 /** Type for packets.  Should be used instead of a mere char[], since it has
  * correct alignment requirements. */
 typedef union {
@@ -145,6 +217,8 @@ typedef union {
 	brlapi_errorPacket_t error;
 	brlapi_getDriverSpecificModePacket_t getDriverSpecificMode;
 	brlapi_writeArgumentsPacket_t writeArguments;
+	brlapi_sharedMemoryPacket_t sharedMemory;
+	brlapi_keyBatchingPacket_t keyBatching;
 	uint32_t uint32;
 } brlapi_packet_t;
 
@@ -41,6 +41,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 
@@ -72,6 +73,7 @@
 #include "file.h"
 #include "parse.h"
 #include "timing.h"
+#include "async.h"
 #include "auth.h"
 #include "io_misc.h"
 #include "scr.h"
@@ -191,8 +193,25 @@ typedef struct {
 #ifdef __MINGW32__
   OVERLAPPED overl;
 #endif /* __MINGW32__ */
+#ifdef BRLAPI_SHARED_MEMORY
+  int descriptors[3]; /* Passed along with the packet */
+  int descriptorCount;
+#endif /* BRLAPI_SHARED_MEMORY */
 } Packet;
 
+#ifdef BRLAPI_SHARED_MEMORY
+typedef struct {
+  void *region;
+  size_t size;
+  FileDescriptor requestEvent; /* Signalled by the client */
+  FileDescriptor keyEvent; /* Signalled by us */
+  brlapi_sharedQueue_t requests;
+  brlapi_sharedQueue_t keys;
+  int overflowed; /* Keys go through the socket until the client has caught up */
+  uint32_t socketKeys; /* Keys sent through the socket */
+} SharedMemory;
+#endif /* BRLAPI_SHARED_MEMORY */
+
 typedef struct Connection {
   struct Connection *prev, *next;
   FileDescriptor fd;
@@ -207,6 +226,16 @@ typedef struct Connection {
   pthread_mutex_t acceptedKeysMutex;
   time_t upTime;
   Packet packet;
+#ifdef BRLAPI_SHARED_MEMORY
+  SharedMemory *shared;
+#endif /* BRLAPI_SHARED_MEMORY */
+  int keyBatching; /* whether keys are held back and sent in batches */
+  unsigned int keyBatchDelay; /* how long the oldest key may be held back */
+  unsigned int keyBatchCount;
+  struct {
+    brlapi_keyCode_t code;
+    TimeValue time;
+  } keyBatch[BRLAPI_MAXPACKETSIZE/sizeof(brlapi_batchedKey_t)];
 } Connection;
 
 typedef struct Tty {
@@ -406,14 +435,219 @@ static void writeException(FileDescriptor fd, unsigned int err, brlapi_packetTyp
   brlapiserver_writePacket(fd,BRLAPI_PACKET_EXCEPTION,&epacket.data, hdrsize+esize);
 }
 
-static void writeKey(FileDescriptor fd, brlapi_keyCode_t key) {
+/* Function : flushKeyBatch */
+/* Sends the keys held back for a connection as one packet */
+/* Must be called with connectionsMutex held */
+static void flushKeyBatch(Connection *c)
+{
+  brlapi_batchedKey_t batch[ARRAY_COUNT(c->keyBatch)];
+  unsigned int i;
+  long int age;
+
+  if (!c->keyBatchCount) return;
+  for (i=0; i<c->keyBatchCount; i++) {
+    batch[i].code[0] = htonl(c->keyBatch[i].code >> 32);
+    batch[i].code[1] = htonl(c->keyBatch[i].code & 0xffffffff);
+    age = getMonotonicElapsed(&c->keyBatch[i].time);
+    batch[i].age = htonl(age>0 ? age : 0);
+  }
+  logMessage(LOG_DEBUG,"writing batch of %u keys",c->keyBatchCount);
+  brlapiserver_writePacket(c->fd,BRLAPI_PACKET_KEYS,batch,c->keyBatchCount*sizeof(batch[0]));
+  c->keyBatchCount = 0;
+}
+
+static void scheduleKeyBatches(void);
+
+static void writeKey(Connection *c, brlapi_keyCode_t key) {
   uint32_t buf[2];
   buf[0] = htonl(key >> 32);
   buf[1] = htonl(key & 0xffffffff);
   logMessage(LOG_DEBUG,"writing key %08"PRIx32" %08"PRIx32,buf[0],buf[1]);
-  brlapiserver_writePacket(fd,BRLAPI_PACKET_KEY,&buf,sizeof(buf));
+#ifdef BRLAPI_SHARED_MEMORY
+  if (c->shared) {
+    SharedMemory *shared = c->shared;
+
+    if (shared->overflowed) {
+      /* the ring may only be used again once all of the keys that went */
+      /* through the socket have been read, else they'd be overtaken */
+      volatile brlapi_sharedMemoryHeader_t *header = shared->region;
+      volatile brlapi_sharedRing_t *ring = shared->keys.ring;
+
+      if ((ring->head == ring->tail) && (header->socketKeys == shared->socketKeys)) {
+        logMessage(LOG_DEBUG,"shared key ring drained on fd %"PRIfd", using it again",c->fd);
+        shared->overflowed = 0;
+      }
+    }
+
+    if (!shared->overflowed) {
+      if (brlapiserver_putSharedRecord(&shared->keys,BRLAPI_PACKET_KEY,&buf,sizeof(buf))) {
+        if (eventfd_write(shared->keyEvent, 1) == -1)
+          logSystemError("eventfd_write");
+        return;
+      }
+      logMessage(LOG_WARNING,"shared key ring full on fd %"PRIfd", using the socket",c->fd);
+      shared->overflowed = 1;
+    }
+
+    shared->socketKeys++;
+  }
+#endif /* BRLAPI_SHARED_MEMORY */
+  if (c->keyBatching) {
+    c->keyBatch[c->keyBatchCount].code = key;
+    getMonotonicTime(&c->keyBatch[c->keyBatchCount].time);
+    if (++c->keyBatchCount == ARRAY_COUNT(c->keyBatch)) flushKeyBatch(c);
+    else if (c->keyBatchCount == 1) scheduleKeyBatches();
+    return;
+  }
+  brlapiserver_writePacket(c->fd,BRLAPI_PACKET_KEY,&buf,sizeof(buf));
+}
+
+#ifdef BRLAPI_SHARED_MEMORY
+/* Function : freeSharedMemory */
+/* Unmaps a shared memory region and closes its event descriptors */
+static void freeSharedMemory(SharedMemory *shared)
+{
+  if (munmap(shared->region, shared->size) == -1) logSystemError("munmap");
+  close(shared->requestEvent);
+  close(shared->keyEvent);
+  free(shared);
+}
+
+/* Function : newSharedMemory */
+/* Maps the shared memory region offered by a client */
+/* The descriptors are taken over on success */
+/* Returns NULL if the region can't be used */
+static SharedMemory *newSharedMemory(const int *descriptors, size_t size)
+{
+  SharedMemory *shared;
+  brlapi_sharedMemoryHeader_t *header;
+  struct stat status;
+
+  if (size < sizeof(*header)) {
+    logMessage(LOG_WARNING, "shared memory region too small: %lu", (unsigned long)size);
+    return NULL;
+  }
+
+  if (fstat(descriptors[0], &status) == -1) {
+    logSystemError("fstat");
+    return NULL;
+  }
+
+  if (status.st_size != size) {
+    logMessage(LOG_WARNING, "shared memory region size mismatch: %lu != %lu", (unsigned long)size, (unsigned long)status.st_size);
+    return NULL;
+  }
+
+#ifdef F_GET_SEALS
+  {
+    /* the client mustn't be able to make our accesses fault */
+    int seals = fcntl(descriptors[0], F_GET_SEALS);
+
+    if ((seals == -1) || !(seals & F_SEAL_SHRINK)) {
+      logMessage(LOG_WARNING, "shared memory region can be shrunk");
+      return NULL;
+    }
+  }
+#endif /* F_GET_SEALS */
+
+  if (!(shared = malloc(sizeof(*shared)))) {
+    logMallocError();
+    return NULL;
+  }
+
+  if ((shared->region = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, descriptors[0], 0)) == MAP_FAILED) {
+    logSystemError("mmap");
+    free(shared);
+    return NULL;
+  }
+  shared->size = size;
+  header = shared->region;
+
+  if ((header->magic != BRLAPI_SHARED_MAGIC) || (header->size != size) ||
+      (brlapiserver_setSharedQueue(&shared->requests, shared->region, size, &header->toServer) == -1) ||
+      (brlapiserver_setSharedQueue(&shared->keys, shared->region, size, &header->toClient) == -1) ||
+      ((shared->requests.data < shared->keys.data)?
+        (shared->requests.data + shared->requests.size > shared->keys.data):
+        (shared->keys.data + shared->keys.size > shared->requests.data))) {
+    logMessage(LOG_WARNING, "invalid shared memory layout");
+    munmap(shared->region, size);
+    free(shared);
+    return NULL;
+  }
+
+  if (!setBlockingIo(descriptors[1], 0) || !setBlockingIo(descriptors[2], 0)) {
+    logSystemError("shared memory events");
+    munmap(shared->region, size);
+    free(shared);
+    return NULL;
+  }
+
+  close(descriptors[0]);
+  shared->requestEvent = descriptors[1];
+  shared->keyEvent = descriptors[2];
+  shared->overflowed = 0;
+  shared->socketKeys = 0;
+  return shared;
+}
+
+/* Function : closePacketDescriptors */
+/* Closes the descriptors which were passed along with a packet but which */
+/* weren't taken over by its handler */
+static void closePacketDescriptors(Packet *packet)
+{
+  while (packet->descriptorCount > 0)
+    close(packet->descriptors[--packet->descriptorCount]);
 }
 
+/* Function : receiveData */
+/* Reads from a connection's socket, keeping the descriptors passed along */
+static ssize_t receiveData(FileDescriptor fd, Packet *packet, void *buffer, size_t size)
+{
+  struct iovec iov;
+  struct msghdr msg;
+  union {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE(sizeof(packet->descriptors))];
+  } control;
+  ssize_t res;
+  int flags = 0;
+
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif /* MSG_CMSG_CLOEXEC */
+
+  iov.iov_base = buffer;
+  iov.iov_len = size;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+
+  if ((res = recvmsg(fd, &msg, flags)) > 0) {
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+        const int *descriptors = (const int *) CMSG_DATA(cmsg);
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(*descriptors);
+        size_t i;
+
+        for (i=0; i<count; i++) {
+          if (packet->descriptorCount < ARRAY_COUNT(packet->descriptors)) {
+            packet->descriptors[packet->descriptorCount++] = descriptors[i];
+          } else {
+            close(descriptors[i]);
+          }
+        }
+      }
+    }
+  }
+
+  return res;
+}
+#endif /* BRLAPI_SHARED_MEMORY */
+
 /* Function: resetPacket */
 /* Resets a Packet structure */
 void resetPacket(Packet *packet)
@@ -443,6 +677,9 @@ int initializePacket(Packet *packet)
     return -1;
   }
 #endif /* __MINGW32__ */
+#ifdef BRLAPI_SHARED_MEMORY
+  packet->descriptorCount = 0;
+#endif /* BRLAPI_SHARED_MEMORY */
   resetPacket(packet);
   return 0;
 }
@@ -470,7 +707,11 @@ read:
 #else /* __MINGW32__ */
   int res;
 read:
+#ifdef BRLAPI_SHARED_MEMORY
+  res = receiveData(c->fd, packet, packet->p, packet->n);
+#else /* BRLAPI_SHARED_MEMORY */
   res = read(c->fd, packet->p, packet->n);
+#endif /* BRLAPI_SHARED_MEMORY */
   if (res==-1) {
     switch (errno) {
       case EINTR: goto read;
@@ -538,6 +779,8 @@ typedef struct { /* packet handlers */
   PacketHandler packet;
   PacketHandler suspendDriver;
   PacketHandler resumeDriver;
+  PacketHandler sharedMemory;
+  PacketHandler keyBatching;
 } PacketHandlers;
 
 /****************************************************************************/
@@ -637,6 +880,12 @@ static Connection *createConnection(FileDescriptor fd, time_t currentTime)
   c->brailleWindow.text = NULL;
   c->brailleWindow.andAttr = NULL;
   c->brailleWindow.orAttr = NULL;
+#ifdef BRLAPI_SHARED_MEMORY
+  c->shared = NULL;
+#endif /* BRLAPI_SHARED_MEMORY */
+  c->keyBatching = 0;
+  c->keyBatchDelay = 0;
+  c->keyBatchCount = 0;
   if (initializePacket(&c->packet))
     goto outmalloc;
   return c;
@@ -657,6 +906,10 @@ static void freeConnection(Connection *c)
     if (c->auth != 1) unauthConnections--;
     closeFileDescriptor(c->fd);
   }
+#ifdef BRLAPI_SHARED_MEMORY
+  closePacketDescriptors(&c->packet);
+  if (c->shared) freeSharedMemory(c->shared);
+#endif /* BRLAPI_SHARED_MEMORY */
   pthread_mutex_destroy(&c->brlMutex);
   pthread_mutex_destroy(&c->acceptedKeysMutex);
   freeBrailleWindow(&c->brailleWindow);
@@ -916,6 +1169,9 @@ static int handleLeaveTtyMode(Connection *c, brlapi_packetType_t type, brlapi_pa
 {
   CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
   CHECKERR(c->tty,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed out of tty mode");
+  pthread_mutex_lock(&connectionsMutex);
+  flushKeyBatch(c);
+  pthread_mutex_unlock(&connectionsMutex);
   doLeaveTty(c);
   writeAck(c->fd);
   return 0;
@@ -1165,17 +1421,70 @@ static int handleResumeDriver(Connection *c, brlapi_packetType_t type, brlapi_pa
   return 0;
 }
 
+static int handleSharedMemory(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
+{
+#ifdef BRLAPI_SHARED_MEMORY
+  Packet *p = &c->packet;
+  SharedMemory *shared;
+  CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
+  CHECKERR(!c->shared,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"shared memory already set up");
+  CHECKERR(size==sizeof(packet->sharedMemory),BRLAPI_ERROR_INVALID_PACKET,"wrong packet size");
+  CHECKERR(p->descriptorCount==3,BRLAPI_ERROR_INVALID_PACKET,"wrong number of descriptors");
+  if (!(shared = newSharedMemory(p->descriptors, ntohl(packet->sharedMemory.size)))) {
+    WERR(c->fd,BRLAPI_ERROR_INVALID_PARAMETER,"unusable shared memory");
+    return 0;
+  }
+  p->descriptorCount = 0;
+  pthread_mutex_lock(&connectionsMutex);
+  c->shared = shared;
+  pthread_mutex_unlock(&connectionsMutex);
+  writeAck(c->fd);
+  logMessage(LOG_DEBUG,"Shared memory set up for fd %"PRIfd" (%lu bytes)",c->fd,(unsigned long)shared->size);
+#else /* BRLAPI_SHARED_MEMORY */
+  WERR(c->fd,BRLAPI_ERROR_OPNOTSUPP,"shared memory not supported");
+#endif /* BRLAPI_SHARED_MEMORY */
+  return 0;
+}
+
+static int handleKeyBatching(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
+{
+  uint32_t delay;
+  CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
+  CHECKERR(size==sizeof(packet->keyBatching),BRLAPI_ERROR_INVALID_PACKET,"wrong packet size");
+  delay = ntohl(packet->keyBatching.delay);
+  CHECKERR((delay==BRLAPI_KEYBATCHING_OFF) || (delay<=BRLAPI_KEYBATCHING_MAXDELAY),BRLAPI_ERROR_INVALID_PARAMETER,"key batching delay too long");
+  pthread_mutex_lock(&connectionsMutex);
+  flushKeyBatch(c);
+  if (delay==BRLAPI_KEYBATCHING_OFF) {
+    c->keyBatching = 0;
+  } else {
+    c->keyBatching = 1;
+    c->keyBatchDelay = delay;
+  }
+  pthread_mutex_unlock(&connectionsMutex);
+  writeAck(c->fd);
+  logMessage(LOG_DEBUG,"Key batching for fd %"PRIfd": %s",c->fd,c->keyBatching?"on":"off");
+  return 0;
+}
+
 static PacketHandlers packetHandlers = {
   handleGetDriverName, handleGetDisplaySize,
   handleEnterTtyMode, handleSetFocus, handleLeaveTtyMode,
   handleKeyRanges, handleKeyRanges, handleWrite,
-  handleEnterRawMode, handleLeaveRawMode, handlePacket, handleSuspendDriver, handleResumeDriver
+  handleEnterRawMode, handleLeaveRawMode, handlePacket, handleSuspendDriver, handleResumeDriver,
+  handleSharedMemory, handleKeyBatching
 };
 
 static void handleNewConnection(Connection *c)
 {
   brlapi_packet_t versionPacket;
+  uint32_t features = 0;
+#ifdef BRLAPI_SHARED_MEMORY
+  features |= BRLAPI_FEATURE_SHAREDMEMORY;
+#endif /* BRLAPI_SHARED_MEMORY */
+  features |= BRLAPI_FEATURE_KEYBATCHING;
   versionPacket.version.protocolVersion = htonl(BRLAPI_PROTOCOL_VERSION);
+  versionPacket.version.features = htonl(features);
 
   brlapiserver_writePacket(c->fd,BRLAPI_PACKET_VERSION,&versionPacket.data,sizeof(versionPacket.version));
 }
@@ -1196,7 +1505,7 @@ static int handleUnauthorizedConnection(Connection *c, brlapi_packetType_t type,
       brlapi_authServerPacket_t *authPacket = &serverPacket.authServer;
       int nbmethods = 0;
 
-      if (size<sizeof(*versionPacket) || ntohl(versionPacket->protocolVersion)!=BRLAPI_PROTOCOL_VERSION) {
+      if (size<sizeof(versionPacket->protocolVersion) || ntohl(versionPacket->protocolVersion)!=BRLAPI_PROTOCOL_VERSION) {
 	WERR(c->fd, BRLAPI_ERROR_PROTOCOL_VERSION, "wrong protocol version");
 	return 1;
       }
@@ -1277,9 +1586,10 @@ static int handleUnauthorizedConnection(Connection *c, brlapi_packetType_t type,
 /* Reads a packet fro c->fd and processes it */
 /* Returns 1 if connection has to be removed */
 /* If EOF is reached, closes fd and frees all associated ressources */
+static void handleRequest(Connection *c, PacketHandlers *handlers, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size);
+
 static int processRequest(Connection *c, PacketHandlers *handlers)
 {
-  PacketHandler p = NULL;
   int res;
   ssize_t size;
   brlapi_packet_t *packet = (brlapi_packet_t *) c->packet.content;
@@ -1330,12 +1640,63 @@ static int processRequest(Connection *c, PacketHandlers *handlers)
   size = c->packet.header.size;
   type = c->packet.header.type;
   
-  if (c->auth!=1) return handleUnauthorizedConnection(c, type, packet, size);
-
-  if (size>BRLAPI_MAXPACKETSIZE) {
+  if (c->auth!=1) {
+    res = handleUnauthorizedConnection(c, type, packet, size);
+  } else if (size>BRLAPI_MAXPACKETSIZE) {
     logMessage(LOG_WARNING, "Discarding too large packet of type %s on fd %"PRIfd,brlapiserver_getPacketTypeName(type), c->fd);
-    return 0;    
+    res = 0;
+  } else {
+    handleRequest(c, handlers, type, packet, size);
+    res = 0;
   }
+#ifdef BRLAPI_SHARED_MEMORY
+  closePacketDescriptors(&c->packet);
+#endif /* BRLAPI_SHARED_MEMORY */
+  return res;
+}
+
+#ifdef BRLAPI_SHARED_MEMORY
+/* Function : processSharedRequests */
+/* Processes the requests queued in a connection's shared memory ring */
+static void processSharedRequests(Connection *c, PacketHandlers *handlers)
+{
+  SharedMemory *shared = c->shared;
+  uint32_t content[BRLAPI_MAXPACKETSIZE/sizeof(uint32_t)+1]; /* +1 for additional \0 */
+  brlapi_packet_t *packet = (brlapi_packet_t *) content;
+  brlapi_packetType_t type;
+  size_t size;
+  eventfd_t count;
+  int res;
+
+  eventfd_read(shared->requestEvent, &count);
+  while ((res = brlapiserver_getSharedRecord(&shared->requests, &type, content, BRLAPI_MAXPACKETSIZE, &size)) > 0) {
+    switch (type) {
+      case BRLAPI_PACKET_WRITE:
+      case BRLAPI_PACKET_SETFOCUS:
+        handleRequest(c, handlers, type, packet, size);
+        break;
+
+      default:
+        WEXC(c->fd, BRLAPI_ERROR_ILLEGAL_INSTRUCTION, type, packet, size, "not allowed in shared memory");
+        break;
+    }
+  }
+
+  if (res < 0) {
+    WEXC(c->fd, BRLAPI_ERROR_INVALID_PACKET, BRLAPI_PACKET_SHAREDMEMORY, NULL, 0, "corrupted shared memory ring");
+    pthread_mutex_lock(&connectionsMutex);
+    c->shared = NULL;
+    pthread_mutex_unlock(&connectionsMutex);
+    freeSharedMemory(shared);
+  }
+}
+#endif /* BRLAPI_SHARED_MEMORY */
+
+/* Function : handleRequest */
+/* Dispatches a request from an authorized connection to its handler */
+static void handleRequest(Connection *c, PacketHandlers *handlers, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
+{
+  PacketHandler p = NULL;
   switch (type) {
     case BRLAPI_PACKET_GETDRIVERNAME: p = handlers->getDriverName; break;
     case BRLAPI_PACKET_GETDISPLAYSIZE: p = handlers->getDisplaySize; break;
@@ -1350,12 +1711,13 @@ static int processRequest(Connection *c, PacketHandlers *handlers)
     case BRLAPI_PACKET_PACKET: p = handlers->packet; break;
     case BRLAPI_PACKET_SUSPENDDRIVER: p = handlers->suspendDriver; break;
     case BRLAPI_PACKET_RESUMEDRIVER: p = handlers->resumeDriver; break;
+    case BRLAPI_PACKET_SHAREDMEMORY: p = handlers->sharedMemory; break;
+    case BRLAPI_PACKET_KEYBATCHING: p = handlers->keyBatching; break;
   }
   if (p!=NULL) {
     logRequest(type, c->fd);
     p(c, type, packet, size);
   } else WEXC(c->fd,BRLAPI_ERROR_UNKNOWN_INSTRUCTION, type, packet, size, "unknown packet type");
-  return 0;
 }
 
 /****************************************************************************/
@@ -1916,6 +2278,12 @@ static void addTtyFds(fd_set *fds, int *fdmax, Tty *tty) {
 #else /* __MINGW32__ */
       if (c->fd>*fdmax) *fdmax = c->fd;
       FD_SET(c->fd,fds);
+#ifdef BRLAPI_SHARED_MEMORY
+      if (c->shared) {
+        if (c->shared->requestEvent>*fdmax) *fdmax = c->shared->requestEvent;
+        FD_SET(c->shared->requestEvent,fds);
+      }
+#endif /* BRLAPI_SHARED_MEMORY */
 #endif /* __MINGW32__ */
     }
   }
@@ -1939,6 +2307,13 @@ static void handleTtyFds(fd_set *fds, time_t currentTime, Tty *tty) {
     while (c!=tty->connections) {
       int remove = 0;
       next = c->next;
+#ifdef BRLAPI_SHARED_MEMORY
+      /* requests queued in the ring precede those still on the socket */
+      if (c->shared && FD_ISSET(c->shared->requestEvent, fds)) {
+        FD_CLR(c->shared->requestEvent,fds);
+        processSharedRequests(c, &packetHandlers);
+      }
+#endif /* BRLAPI_SHARED_MEMORY */
 #ifdef __MINGW32__
       if (WaitForSingleObject(c->packet.overl.hEvent,0) == WAIT_OBJECT_0)
 #else /* __MINGW32__ */
@@ -2143,6 +2518,14 @@ static void *server(void *arg)
             continue;
           }
           formatAddress(source, sizeof(source), &addr, addrlen);
+#if defined(IPPROTO_TCP) && defined(TCP_NODELAY)
+          if (socketInfo[i].addrfamily != PF_LOCAL) {
+            /* not all systems let it be inherited from the listening socket */
+            int yes = 1;
+            if (setsockopt(resfd,IPPROTO_TCP,TCP_NODELAY,(void*)&yes,sizeof(yes))!=0)
+              logMessage(LOG_WARNING, "setsockopt(NODELAY): %s", strerror(errno));
+          }
+#endif /* defined(IPPROTO_TCP) && defined(TCP_NODELAY) */
 
 #ifdef __MINGW32__
         }
@@ -2388,6 +2771,68 @@ found:
   return c;
 }
 
+/* Function : flushKeyBatches */
+/* Sends the batches whose oldest key has been held back long enough */
+static void flushKeyBatches(Tty *tty) {
+  Connection *c;
+  Tty *t;
+  for (c=tty->connections->next; c!=tty->connections; c = c->next)
+    if (c->keyBatchCount && (getMonotonicElapsed(&c->keyBatch[0].time) >= c->keyBatchDelay))
+      flushKeyBatch(c);
+  for (t = tty->subttys; t; t = t->next)
+    flushKeyBatches(t);
+}
+
+/* Function : getKeyBatchDelay */
+/* Returns how long until the first of the batches held back is due, */
+/* or -1 if there are none */
+static long int getKeyBatchDelay(Tty *tty, long int delay) {
+  Connection *c;
+  Tty *t;
+  for (c=tty->connections->next; c!=tty->connections; c = c->next)
+    if (c->keyBatchCount) {
+      long int left = c->keyBatchDelay - getMonotonicElapsed(&c->keyBatch[0].time);
+      if (left < 0) left = 0;
+      if ((delay < 0) || (left < delay)) delay = left;
+    }
+  for (t = tty->subttys; t; t = t->next)
+    delay = getKeyBatchDelay(t, delay);
+  return delay;
+}
+
+/* The alarm which sends the batches of keys when they're due. Connections */
+/* are freed by the server thread, so there's one alarm for all of them, */
+/* and it's only touched by the core thread. */
+static AsyncHandle keyBatchAlarm = NULL;
+
+static void handleKeyBatchAlarm(const AsyncAlarmResult *result) {
+  asyncDiscardHandle(keyBatchAlarm);
+  keyBatchAlarm = NULL;
+
+  pthread_mutex_lock(&connectionsMutex);
+  flushKeyBatches(&ttys);
+  scheduleKeyBatches();
+  pthread_mutex_unlock(&connectionsMutex);
+}
+
+/* Function : scheduleKeyBatches */
+/* Sets the key batch alarm for the first batch which will be due */
+/* Must be called with connectionsMutex held, by the core thread */
+static void scheduleKeyBatches(void) {
+  long int delay = getKeyBatchDelay(&ttys, -1);
+
+  if (delay < 0) {
+    if (keyBatchAlarm) {
+      asyncCancelRequest(keyBatchAlarm);
+      keyBatchAlarm = NULL;
+    }
+  } else if (keyBatchAlarm) {
+    asyncResetAlarmIn(keyBatchAlarm, delay);
+  } else if (!asyncSetAlarmIn(&keyBatchAlarm, delay, handleKeyBatchAlarm, NULL)) {
+    keyBatchAlarm = NULL;
+  }
+}
+
 /* Temporary function, until we implement proper generic support for variables.
  */
 static void broadcastKey(Tty *tty, brlapi_keyCode_t code, unsigned int how) {
@@ -2396,7 +2841,7 @@ static void broadcastKey(Tty *tty, brlapi_keyCode_t code, unsigned int how) {
   for (c=tty->connections->next; c!=tty->connections; c = c->next) {
     pthread_mutex_lock(&c->acceptedKeysMutex);
     if ((c->how==how) && (inKeyrangeList(c->acceptedKeys,code) != NULL))
-      writeKey(c->fd,code);
+      writeKey(c,code);
     pthread_mutex_unlock(&c->acceptedKeysMutex);
   }
   for (t = tty->subttys; t; t = t->next)
@@ -2415,7 +2860,7 @@ static int api__handleKeyEvent(brlapi_keyCode_t clientCode) {
   /* somebody gets the raw code */
   if ((c = whoGetsKey(&ttys,clientCode,BRL_KEYCODES))) {
     logMessage(LOG_DEBUG,"Transmitting accepted key %016"BRLAPI_PRIxKEYCODE, clientCode);
-    writeKey(c->fd,clientCode);
+    writeKey(c,clientCode);
     return EOF;
   }
   return 0;
@@ -2456,7 +2901,7 @@ static int api__handleCommand(int command) {
     /* nobody needs the raw code */
     if ((c = whoGetsKey(&ttys,clientCode,BRL_COMMANDS))) {
       logMessage(LOG_DEBUG,"Transmitting accepted command %lx as client code %016"BRLAPI_PRIxKEYCODE,(unsigned long)command, clientCode);
-      writeKey(c->fd,clientCode);
+      writeKey(c,clientCode);
       return EOF;
     }
   }
@@ -2813,5 +3258,9 @@ out:
 /* Closes the driver */
 void api_stop(BrailleDisplay *brl)
 {
+  if (keyBatchAlarm) {
+    asyncCancelRequest(keyBatchAlarm);
+    keyBatchAlarm = NULL;
+  }
   terminationHandler();
 }
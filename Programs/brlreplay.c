@@ -0,0 +1,310 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2013 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://mielke.cc/brltty/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* brlreplay.c - Feed a generic I/O capture back into a braille driver
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "file.h"
+#include "parse.h"
+#include "timing.h"
+#include "async.h"
+#include "cmd.h"
+#include "ktb.h"
+#include "brl.h"
+
+#define REPLAY_IDLE_LIMIT 10
+
+static char *opt_driversDirectory;
+static char *opt_tablesDirectory;
+static int opt_logKeys;
+static int opt_logStatistics;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 'k',
+    .word = "keys",
+    .setting.flag = &opt_logKeys,
+    .description = "Log key events."
+  },
+
+  { .letter = 's',
+    .word = "statistics",
+    .setting.flag = &opt_logStatistics,
+    .description = "Log generic I/O statistics."
+  },
+
+  { .letter = 'D',
+    .word = "drivers-directory",
+    .flags = OPT_Hidden,
+    .argument = "directory",
+    .setting.string = &opt_driversDirectory,
+    .defaultSetting = DRIVERS_DIRECTORY,
+    .description = "Path to directory for loading drivers."
+  },
+
+  { .letter = 'T',
+    .word = "tables-directory",
+    .flags = OPT_Hidden,
+    .argument = "directory",
+    .setting.string = &opt_tablesDirectory,
+    .defaultSetting = TABLES_DIRECTORY,
+    .description = "Path to directory containing tables."
+  },
+END_OPTION_TABLE
+
+static BrailleDisplay brl;
+
+static char **
+getParameterSettings (const char *const *names, int count, char **assignments) {
+  char **settings;
+  unsigned int size = 0;
+
+  while (names[size]) size += 1;
+
+  if ((settings = malloc((size + 1) * sizeof(*settings)))) {
+    unsigned int index;
+
+    for (index=0; index<size; index+=1) settings[index] = "";
+    settings[size] = NULL;
+
+    while (count) {
+      char *assignment = *assignments++;
+      char *delimiter = strchr(assignment, '=');
+      int ok = 0;
+
+      if (!delimiter) {
+        logMessage(LOG_ERR, "missing braille driver parameter value: %s", assignment);
+      } else if (delimiter == assignment) {
+        logMessage(LOG_ERR, "missing braille driver parameter name: %s", assignment);
+      } else {
+        size_t length = delimiter - assignment;
+
+        for (index=0; index<size; index+=1) {
+          if (strncasecmp(assignment, names[index], length) == 0) {
+            settings[index] = delimiter + 1;
+            ok = 1;
+            break;
+          }
+        }
+
+        if (!ok) logMessage(LOG_ERR, "invalid braille driver parameter: %s", assignment);
+      }
+
+      if (!ok) {
+        free(settings);
+        return NULL;
+      }
+
+      count -= 1;
+    }
+  } else {
+    logMallocError();
+  }
+
+  return settings;
+}
+
+static void
+loadKeyTable (void) {
+  if (brl.keyBindings && brl.keyNameTables) {
+    char *file;
+
+    {
+      const char *strings[] = {
+        "brl-", braille->definition.code, "-", brl.keyBindings, KEY_TABLE_EXTENSION
+      };
+
+      file = joinStrings(strings, ARRAY_COUNT(strings));
+    }
+
+    if (file) {
+      char *path;
+
+      if ((path = makePath(opt_tablesDirectory, file))) {
+        if ((brl.keyTable = compileKeyTable(path, brl.keyNameTables))) {
+          if (opt_logKeys) {
+            setKeyEventLoggingFlag(brl.keyTable, &LOG_CATEGORY_FLAG(BRAILLE_KEY_EVENTS));
+          }
+        } else {
+          logMessage(LOG_WARNING, "cannot open key table: %s", path);
+        }
+
+        free(path);
+      }
+
+      free(file);
+    }
+  }
+}
+
+static unsigned long
+replayCommands (void) {
+  unsigned long count = 0;
+  unsigned int idle = 0;
+
+  while (idle < REPLAY_IDLE_LIMIT) {
+    int command = readBrailleCommand(&brl, KTB_CTX_DEFAULT);
+
+    if (command == EOF) {
+      /* let pending key table alarms (e.g. long presses) fire */
+      asyncWait(0);
+      idle += 1;
+      continue;
+    }
+
+    idle = 0;
+    if ((command & BRL_MSK_CMD) == BRL_CMD_RESTARTBRL) break;
+
+    {
+      char buffer[0X100];
+
+      describeCommand(command, buffer, sizeof(buffer),
+                      CDO_IncludeName | CDO_IncludeOperand);
+      printf("%s\n", buffer);
+    }
+
+    count += 1;
+  }
+
+  return count;
+}
+
+int
+main (int argc, char *argv[]) {
+  ProgramExitStatus exitStatus;
+  const char *capture;
+  const char *driver;
+  void *object;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "brlreplay",
+      .argumentsSummary = "capture-file driver [parameter=value ...]"
+    };
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  {
+    char **const paths[] = {
+      &opt_driversDirectory,
+      &opt_tablesDirectory,
+      NULL
+    };
+    fixInstallPaths(paths);
+  }
+
+  if (argc < 2) {
+    logMessage(LOG_ERR, "missing %s", (argc? "driver": "capture file"));
+    return PROG_EXIT_SYNTAX;
+  }
+
+  capture = *argv++;
+  driver = *argv++;
+  argc -= 2;
+
+  if (opt_logKeys) enableLogCategory("brlkeys");
+  if (opt_logStatistics) enableLogCategory("statgio");
+
+  if ((braille = loadBrailleDriver(driver, &object, opt_driversDirectory))) {
+    static const char *const noNames[] = {NULL};
+    const char *const *names = braille->parameters? braille->parameters: noNames;
+    char **parameters = getParameterSettings(names, argc, argv);
+
+    if (!parameters) return PROG_EXIT_SYNTAX;
+
+    {
+      const char *strings[] = {"replay:", capture};
+      char *device = joinStrings(strings, ARRAY_COUNT(strings));
+
+      if (!device) return PROG_EXIT_FATAL;
+      initializeBrailleDisplay(&brl);
+
+      if (braille->construct(&brl, parameters, device)) {
+        TimeValue start;
+        unsigned long count;
+
+        loadKeyTable();
+
+        getMonotonicTime(&start);
+        count = replayCommands();
+        logMessage(LOG_NOTICE, "commands: %lu, time: %ldms",
+                   count, getMonotonicElapsed(&start));
+
+        braille->destruct(&brl);
+        if (brl.keyTable) destroyKeyTable(brl.keyTable);
+        exitStatus = PROG_EXIT_SUCCESS;
+      } else {
+        logMessage(LOG_ERR, "can't initialize braille driver.");
+        exitStatus = PROG_EXIT_FATAL;
+      }
+
+      free(device);
+    }
+
+    free(parameters);
+  } else {
+    logMessage(LOG_ERR, "can't load braille driver.");
+    exitStatus = PROG_EXIT_FATAL;
+  }
+
+  return exitStatus;
+}
+
+#include "brltty.h"
+
+unsigned int textStart;
+unsigned int textCount;
+int apiStarted = 0;
+
+unsigned char
+getCursorDots (void) {
+  return BRL_DOT7 | BRL_DOT8;
+}
+
+int
+api_handleCommand (int command) {
+  return command;
+}
+
+int
+api_handleKeyEvent (unsigned char set, unsigned char key, int press) {
+  return EOF;
+}
+
+#include "message.h"
+
+int
+message (const char *mode, const char *text, short flags) {
+  return 1;
+}
+
+#include "scr.h"
+
+int
+currentVirtualTerminal (void) {
+  return 0;
+}
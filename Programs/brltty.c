@@ -61,6 +61,7 @@
 #include "ses.h"
 #include "brl.h"
 #include "brltty.h"
+#include "keytrace.h"
 #include "prefs.h"
 #include "defaults.h"
 
@@ -290,7 +291,9 @@ writeBrailleCharacters (const char *mode, const wchar_t *characters, size_t leng
 
   fillStatusSeparator(textBuffer, brl.buffer);
 
-  return braille->writeWindow(&brl, textBuffer);
+  if (!braille->writeWindow(&brl, textBuffer)) return 0;
+  markWrittenKeyTraces();
+  return 1;
 }
 
 int
@@ -1795,7 +1798,7 @@ static int inputModifiers;
 
 static int
 brlttyPrepare_next (void) {
-  drainBrailleOutput(&brl, updateInterval);
+  drainBrailleOutput(&brl, getBrailleFrameDelay(&brl, updateInterval));
   updateSessionAttributes();
   return 1;
 }
@@ -3354,6 +3357,8 @@ doCommand:
     }
   }
 
+  markKeyTrace(KTR_EXECUTED);
+  resumeKeyTrace(0);
   return 1;
 }
 
@@ -3424,7 +3429,7 @@ brlttyUpdate (void) {
     updateBlinkingState(&speechCursorBlinkingState);
 
 #ifdef ENABLE_SPEECH_SUPPORT
-    /* called continually even if we're not tracking so that the pipe doesn't fill up. */
+    /* called continually even if we're not tracking so that drivers which poll for indices don't fall behind. */
     speech->doTrack(&spk);
 
     if (speechTracking && !speech->isSpeaking(&spk)) speechTracking = 0;
@@ -3903,7 +3908,10 @@ brlttyUpdate (void) {
           fillStatusSeparator(textBuffer, brl.buffer);
         }
 
-        if (!(writeStatusCells() && braille->writeWindow(&brl, textBuffer))) restartRequired = 1;
+        if (canWriteBrailleFrame(&brl)) {
+          if (!(writeStatusCells() && braille->writeWindow(&brl, textBuffer))) restartRequired = 1;
+          wroteBrailleFrame(&brl);
+        }
       }
     }
 
@@ -55,10 +55,12 @@
 #include "brltty.h"
 #include "prefs.h"
 #include "charset.h"
+#include "bitfield.h"
 
 #include "io_serial.h"
 #include "io_usb.h"
 #include "io_bluetooth.h"
+#include "io_capture.h"
 
 #ifdef __MINGW32__
 int isWindowsService = 0;
@@ -90,6 +92,7 @@ static int opt_noDaemon;
 static int opt_standardError;
 static char *opt_logLevel;
 static char *opt_logFile;
+static char *opt_captureFile;
 static int opt_bootParameters = 1;
 static int opt_environmentVariables;
 static char *opt_updateInterval;
@@ -487,6 +490,14 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = strtext("Path to log file.")
   },
 
+  { .letter = 'G',
+    .word = "capture-file",
+    .flags = OPT_Hidden | OPT_Config | OPT_Environ,
+    .argument = strtext("file"),
+    .setting.string = &opt_captureFile,
+    .description = strtext("Path to braille device input/output capture file.")
+  },
+
   { .letter = 'e',
     .word = "standard-error",
     .flags = OPT_Hidden,
@@ -1131,13 +1142,168 @@ initializeBrailleDriver (const char *code, int verify) {
   return 0;
 }
 
+typedef struct {
+  const char *const *drivers;
+  unsigned char *found;
+} UsbDriverSearchData;
+
+static int
+chooseUsbDrivers (UsbDevice *device, void *data) {
+  UsbDriverSearchData *uds = data;
+  const UsbDeviceDescriptor *descriptor = usbDeviceDescriptor(device);
+  const char *const *code = usbGetDriverCodes(getLittleEndian16(descriptor->idVendor),
+                                              getLittleEndian16(descriptor->idProduct));
+
+  if (code) {
+    while (*code) {
+      const char *const *driver = uds->drivers;
+
+      while (*driver) {
+        if (strcmp(*driver, *code) == 0) {
+          uds->found[driver - uds->drivers] = 1;
+          break;
+        }
+
+        driver += 1;
+      }
+
+      code += 1;
+    }
+  }
+
+  return 0;
+}
+
+static void
+orderUsbDrivers (const char *const *drivers, const char **ordered, size_t size) {
+  unsigned char found[size];
+  UsbDriverSearchData uds = {
+    .drivers = drivers,
+    .found = found
+  };
+  size_t count = 0;
+  unsigned int pass;
+
+  memset(found, 0, size);
+  usbFindDevice(chooseUsbDrivers, &uds);
+
+  /* Drivers for the devices which are actually attached go first. */
+  for (pass=0; pass<2; pass+=1) {
+    const char *const *driver = drivers;
+
+    while (*driver) {
+      if (found[driver - drivers] == !pass) {
+        if (!pass) {
+          logMessage(LOG_DEBUG, "USB braille device attached for driver: %s", *driver);
+        }
+
+        ordered[count++] = *driver;
+      }
+
+      driver += 1;
+    }
+  }
+
+  ordered[count] = NULL;
+}
+
+static char *
+makeLastBrailleDriverPath (void) {
+  return makeWritablePath(PACKAGE_NAME "-braille.last");
+}
+
+static int
+activateLastBrailleDriver (const char *code, const char *device) {
+  const char *const *requestedDevice = (const char *const *)brailleDevices;
+  const char *const *requestedDriver = (const char *const *)brailleDrivers;
+
+  while (*requestedDevice) {
+    if (strcmp(*requestedDevice, device) == 0) break;
+    requestedDevice += 1;
+  }
+  if (!*requestedDevice) return 0;
+
+  if (requestedDriver[0] && !requestedDriver[1] &&
+      (strcmp(requestedDriver[0], "auto") == 0)) {
+    if (!haveBrailleDriver(code)) return 0;
+  } else {
+    while (*requestedDriver) {
+      if (strcmp(*requestedDriver, code) == 0) break;
+      requestedDriver += 1;
+    }
+    if (!*requestedDriver) return 0;
+  }
+
+  brailleDevice = *requestedDevice;
+  logMessage(LOG_DEBUG, "checking last braille driver: %s -> %s", code, brailleDevice);
+  if (initializeBrailleDriver(code, 0)) return 1;
+
+  brailleDevice = NULL;
+  return 0;
+}
+
+static int
+loadLastBrailleDriver (void) {
+  int activated = 0;
+  char *path = makeLastBrailleDriverPath();
+
+  if (path) {
+    FILE *file = openFile(path, "r", 1);
+
+    if (file) {
+      char *buffer = NULL;
+      size_t size = 0;
+
+      if (readLine(file, &buffer, &size)) {
+        char *device = strchr(buffer, ' ');
+
+        if (device) {
+          *device++ = 0;
+          activated = activateLastBrailleDriver(buffer, device);
+        }
+      }
+
+      if (buffer) free(buffer);
+      fclose(file);
+    }
+
+    free(path);
+  }
+
+  return activated;
+}
+
+static void
+saveLastBrailleDriver (void) {
+  char *path = makeLastBrailleDriverPath();
+
+  if (path) {
+    FILE *file = openFile(path, "w", 0);
+
+    if (file) {
+      fprintf(file, "%s %s\n", braille->definition.code, brailleDevice);
+      if (ferror(file)) logMessage(LOG_WARNING, "cannot write last braille driver: %s", path);
+      fclose(file);
+    }
+
+    free(path);
+  }
+}
+
 static int
 activateBrailleDriver (int verify) {
   int oneDevice = brailleDevices[0] && !brailleDevices[1];
+  int oneDriver = brailleDrivers[0] && !brailleDrivers[1] &&
+                  (strcmp(brailleDrivers[0], "auto") != 0);
   const char *const *device = (const char *const *)brailleDevices;
 
   if (!oneDevice) verify = 0;
 
+  /* When there's a choice, first try whatever worked last time. */
+  if (!verify && !(oneDevice && oneDriver)) {
+    if (loadLastBrailleDriver()) return 1;
+  }
+
   while (*device) {
     const char *const *autodetectableDrivers;
 
@@ -1158,7 +1324,10 @@ activateBrailleDriver (int verify) {
           "al", "bm", "eu", "fs", "ht", "hm", "hw", "mt", "pg", "pm", "sk", "vo",
           NULL
         };
-        autodetectableDrivers = usbDrivers;
+        static const char *orderedDrivers[ARRAY_COUNT(usbDrivers)];
+
+        orderUsbDrivers(usbDrivers, orderedDrivers, ARRAY_COUNT(usbDrivers));
+        autodetectableDrivers = orderedDrivers;
       } else if (isBluetoothDevice(&dev)) {
         if (!(autodetectableDrivers = bthGetDriverCodes(dev))) {
           static const char *bluetoothDrivers[] = {
@@ -1182,7 +1351,10 @@ activateBrailleDriver (int verify) {
         .haveDriver = haveBrailleDriver,
         .initializeDriver = initializeBrailleDriver
       };
-      if (activateDriver(&data, verify)) return 1;
+      if (activateDriver(&data, verify)) {
+        if (!verify && !(oneDevice && oneDriver)) saveLastBrailleDriver();
+        return 1;
+      }
     }
 
     device += 1;
@@ -2004,6 +2176,14 @@ brlttyStart (int argc, char *argv[]) {
    * be used instead.
    */
 
+  if (startLogThread()) onProgramExit(stopLogThread, "log-thread");
+
+  if (*opt_captureFile) {
+    if (gioStartCapture(opt_captureFile)) {
+      onProgramExit(gioStopCapture, "capture-file");
+    }
+  }
+
   onProgramExit(exitScreens, "screens");
   constructSpecialScreens();
   enableBrailleHelpPage(); /* ensure that it's first */
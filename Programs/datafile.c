@@ -22,6 +22,11 @@
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif /* HAVE_SYS_MMAN_H */
 
 #include "log.h"
 #include "file.h"
@@ -38,7 +43,7 @@ struct DataFileStruct {
   DataProcessor *processor;
   void *data;
 
-  Queue *variables;
+  DataVariables *variables;
 
   const wchar_t *start;
   const wchar_t *end;
@@ -157,41 +162,91 @@ isNumber (int *number, const wchar_t *characters, int length) {
   return 0;
 }
 
-typedef struct {
+typedef struct DataVariableStruct DataVariable;
+
+struct DataVariableStruct {
+  DataVariable *next;
+  unsigned int hash;
+
   DataOperand name;
   DataOperand value;
-} DataVariable;
+};
+
+#define DATA_VARIABLE_HASH_SIZE 0X40
+
+struct DataVariablesStruct {
+  DataVariables *previous;
+  DataVariable *buckets[DATA_VARIABLE_HASH_SIZE];
+};
+
+static DataVariables *
+newDataVariables (DataVariables *previous) {
+  DataVariables *variables;
+
+  if ((variables = malloc(sizeof(*variables)))) {
+    memset(variables, 0, sizeof(*variables));
+    variables->previous = previous;
+    return variables;
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
 
 static void
-deallocateDataVariable (void *item, void *data UNUSED) {
-  DataVariable *variable = item;
+deallocateDataVariables (DataVariables *variables) {
+  unsigned int index;
 
-  if (variable->name.characters) free((void *)variable->name.characters);
-  if (variable->value.characters) free((void *)variable->value.characters);
-  free(variable);
+  for (index=0; index<DATA_VARIABLE_HASH_SIZE; index+=1) {
+    DataVariable *variable = variables->buckets[index];
+
+    while (variable) {
+      DataVariable *next = variable->next;
+
+      if (variable->name.characters) free((void *)variable->name.characters);
+      if (variable->value.characters) free((void *)variable->value.characters);
+      free(variable);
+
+      variable = next;
+    }
+  }
+
+  free(variables);
 }
 
-static Queue *
-newDataVariableQueue (Queue *previous) {
-  Queue *queue = newQueue(deallocateDataVariable, NULL);
-  if (queue) setQueueData(queue, previous);
-  return queue;
+static unsigned int
+hashDataVariableName (const DataOperand *name) {
+  unsigned int hash = 0;
+  unsigned int index;
+
+  for (index=0; index<name->length; index+=1) {
+    hash = (hash * 31) + name->characters[index];
+  }
+
+  return hash;
 }
 
-static int
-testDataVariableName (const void *item, const void *data) {
-  const DataVariable *variable = item;
-  const DataOperand *name = data;
-  if (variable->name.length == name->length)
-    if (wmemcmp(variable->name.characters, name->characters, name->length) == 0)
-      return 1;
+static DataVariable *
+findDataVariable (DataVariables *variables, const DataOperand *name, unsigned int hash) {
+  DataVariable *variable = variables->buckets[hash % DATA_VARIABLE_HASH_SIZE];
 
-  return 0;
+  while (variable) {
+    if (variable->hash == hash)
+      if (variable->name.length == name->length)
+        if (wmemcmp(variable->name.characters, name->characters, name->length) == 0)
+          return variable;
+
+    variable = variable->next;
+  }
+
+  return NULL;
 }
 
 static DataVariable *
-getDataVariable (Queue *variables, const DataOperand *name, int create) {
-  DataVariable *variable = findItem(variables, testDataVariableName, name);
+getDataVariable (DataVariables *variables, const DataOperand *name, int create) {
+  unsigned int hash = hashDataVariableName(name);
+  DataVariable *variable = findDataVariable(variables, name, hash);
   if (variable) return variable;
 
   if (create) {
@@ -201,15 +256,18 @@ getDataVariable (Queue *variables, const DataOperand *name, int create) {
       memset(variable, 0, sizeof(*variable));
 
       if ((nameCharacters = malloc(ARRAY_SIZE(nameCharacters, name->length)))) {
+        DataVariable **bucket = &variables->buckets[hash % DATA_VARIABLE_HASH_SIZE];
+
         variable->name.characters = wmemcpy(nameCharacters, name->characters, name->length);
         variable->name.length = name->length;
+        variable->hash = hash;
 
         variable->value.characters = NULL;
         variable->value.length = 0;
 
-        if (enqueueItem(variables, variable)) return variable;
-
-        free(nameCharacters);
+        variable->next = *bucket;
+        *bucket = variable;
+        return variable;
       } else {
         logMallocError();
       }
@@ -225,12 +283,13 @@ getDataVariable (Queue *variables, const DataOperand *name, int create) {
 
 static const DataVariable *
 getReadableDataVariable (DataFile *file, const DataOperand *name) {
-  Queue *variables = file->variables;
+  unsigned int hash = hashDataVariableName(name);
+  DataVariables *variables = file->variables;
 
   do {
-    DataVariable *variable = getDataVariable(variables, name, 0);
+    DataVariable *variable = findDataVariable(variables, name, hash);
     if (variable) return variable;
-  } while ((variables = getQueueData(variables)));
+  } while ((variables = variables->previous));
 
   return NULL;
 }
@@ -259,11 +318,11 @@ setDataVariable (DataVariable *variable, const wchar_t *characters, int length)
   return 1;
 }
 
-static Queue *
+static DataVariables *
 getGlobalDataVariables () {
-  static Queue *variables = NULL;
+  static DataVariables *variables = NULL;
 
-  if (!variables) variables = newDataVariableQueue(NULL);
+  if (!variables) variables = newDataVariables(NULL);
   return variables;
 }
 
@@ -288,7 +347,7 @@ setGlobalDataVariable (const char *name, const char *value) {
   }
 
   {
-    Queue *variables = getGlobalDataVariables();
+    DataVariables *variables = getGlobalDataVariables();
 
     if (variables) {
       const DataOperand nameArgument = {
@@ -857,6 +916,12 @@ processAssignOperands (DataFile *file, void *data UNUSED) {
   return 1;
 }
 
+static int processDataPath (
+  DataVariables *variables,
+  const char *path,
+  DataProcessor processor, void *data
+);
+
 int
 includeDataFile (DataFile *file, const wchar_t *name, unsigned int length) {
   int ok = 0;
@@ -875,16 +940,12 @@ includeDataFile (DataFile *file, const wchar_t *name, unsigned int length) {
 
     {
       char path[prefixLength + suffixLength + 1];
-      FILE *stream;
 
       snprintf(path, sizeof(path), "%.*s%.*s",
                (int)prefixLength, prefixAddress,
                (int)suffixLength, suffixAddress);
 
-      if ((stream = openDataFile(path, "r", 0))) {
-        if (processDataStream(file->variables, stream, path, file->processor, file->data)) ok = 1;
-        fclose(stream);
-      }
+      if (processDataPath(file->variables, path, file->processor, file->data)) ok = 1;
     }
 
     free(suffixAddress);
@@ -942,30 +1003,319 @@ processWcharLine (DataFile *file, const wchar_t *line) {
   return file->processor(file, file->data);
 }
 
+/* A data file is decoded all at once into one array of NUL-terminated lines.
+ * Files which are included by many tables are kept in this form so that
+ * they needn't be read and decoded again.
+ */
+
+typedef struct {
+  unsigned int offset;
+  unsigned int error; /* one more than the offset of an illegal UTF-8 byte */
+} DataLine;
+
+typedef struct {
+  wchar_t *characters;
+  unsigned int size;
+
+  DataLine *lines;
+  unsigned int count;
+
+  unsigned int users;
+} DataText;
+
+static void
+deallocateDataText (DataText *text) {
+  if (text->characters) free(text->characters);
+  if (text->lines) free(text->lines);
+  free(text);
+}
+
+static DataText *
+decodeDataText (const char *bytes, size_t size) {
+  /* Every line must be followed by a new-line or by a NUL. */
+  const char *end = bytes + size;
+  DataText *text;
+
+  if ((text = malloc(sizeof(*text)))) {
+    memset(text, 0, sizeof(*text));
+
+    {
+      const char *byte = bytes;
+
+      while (byte < end) {
+        const char *newLine = memchr(byte, '\n', end-byte);
+
+        text->count += 1;
+        if (!newLine) break;
+        byte = newLine + 1;
+      }
+    }
+
+    text->size = size + text->count;
+
+    if ((text->characters = malloc(ARRAY_SIZE(text->characters, text->size)))) {
+      if ((text->lines = malloc(ARRAY_SIZE(text->lines, text->count)))) {
+        wchar_t *character = text->characters;
+        DataLine *line = text->lines;
+        const char *start = bytes;
+
+        while (start < end) {
+          const char *stop = memchr(start, '\n', end-start);
+          const char *next;
+
+          if (stop) {
+            next = stop + 1;
+            if ((stop > start) && (stop[-1] == '\r')) stop -= 1;
+          } else {
+            stop = next = end;
+          }
+
+          if (line == text->lines) {
+            static const char utf8ByteOrderMark[] = {0XEF, 0XBB, 0XBF};
+            static const unsigned int length = sizeof(utf8ByteOrderMark);
+
+            if (((stop - start) >= length) && (memcmp(start, utf8ByteOrderMark, length) == 0)) {
+              start += length;
+            }
+          }
+
+          line->offset = character - text->characters;
+          line->error = 0;
+
+          {
+            const char *byte = start;
+
+            while ((byte < stop) && *byte) {
+              size_t utfs = UTF8_LEN_MAX;
+              wint_t wc = convertUtf8ToWchar(&byte, &utfs);
+
+              if (wc == WEOF) break;
+              *character++ = wc;
+            }
+
+            if ((byte < stop) && *byte) line->error = (byte - start) + 1;
+          }
+
+          *character++ = 0;
+          line += 1;
+          start = next;
+        }
+
+        text->count = line - text->lines;
+        text->size = character - text->characters;
+
+        if (text->size) {
+          wchar_t *characters = realloc(text->characters, ARRAY_SIZE(characters, text->size));
+          if (characters) text->characters = characters;
+        }
+
+        return text;
+      } else {
+        logMallocError();
+      }
+
+      free(text->characters);
+    } else {
+      logMallocError();
+    }
+
+    free(text);
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+static DataText *
+readDataText (FILE *stream) {
+  DataText *text = NULL;
+
+#ifdef HAVE_SYS_MMAN_H
+  {
+    int descriptor = fileno(stream);
+    struct stat status;
+
+    if ((descriptor != -1) && (fstat(descriptor, &status) != -1) &&
+        S_ISREG(status.st_mode) && (status.st_size > 0) &&
+        (ftell(stream) == 0)) {
+      size_t size = status.st_size;
+      void *address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+      if (address != MAP_FAILED) {
+        const char *bytes = address;
+
+        /* the last line must be terminated within the mapping */
+        if (bytes[size-1] == '\n') {
+          text = decodeDataText(bytes, size);
+          munmap(address, size);
+          return text;
+        }
+
+        munmap(address, size);
+      }
+    }
+  }
+#endif /* HAVE_SYS_MMAN_H */
+
+  {
+    size_t size = 0X1000;
+    size_t length = 0;
+    char *buffer = malloc(size);
+
+    if (buffer) {
+      while (1) {
+        size_t count;
+
+        if (length == (size - 1)) {
+          size_t newSize = size << 1;
+          char *newBuffer = realloc(buffer, newSize);
+
+          if (!newBuffer) {
+            logMallocError();
+            break;
+          }
+
+          buffer = newBuffer;
+          size = newSize;
+        }
+
+        if (!(count = fread(&buffer[length], 1, (size - 1 - length), stream))) {
+          if (ferror(stream)) {
+            logSystemError("read");
+          } else {
+            buffer[length] = 0;
+            text = decodeDataText(buffer, length);
+          }
+
+          break;
+        }
+
+        length += count;
+      }
+
+      free(buffer);
+    } else {
+      logMallocError();
+    }
+  }
+
+  return text;
+}
+
+#define DATA_TEXT_CACHE_LIMIT 0X40000
+#define DATA_TEXT_CACHE_ENTRY_LIMIT 0X10000
+
+typedef struct {
+  dev_t device;
+  ino_t inode;
+  off_t size;
+  time_t modified;
+
+  DataText *text;
+} DataTextCacheEntry;
+
+static unsigned int dataTextCacheSize = 0;
+
+static void
+deallocateDataTextCacheEntry (void *item, void *data UNUSED) {
+  DataTextCacheEntry *entry = item;
+
+  dataTextCacheSize -= entry->text->size;
+  deallocateDataText(entry->text);
+  free(entry);
+}
+
+static Queue *
+getDataTextCache (void) {
+  static Queue *cache = NULL;
+
+  if (!cache) cache = newQueue(deallocateDataTextCacheEntry, NULL);
+  return cache;
+}
+
+static int
+testDataTextCacheEntry (const void *item, const void *data) {
+  const DataTextCacheEntry *entry = item;
+  const struct stat *status = data;
+
+  return (entry->device == status->st_dev) &&
+         (entry->inode == status->st_ino) &&
+         (entry->size == status->st_size) &&
+         (entry->modified == status->st_mtime);
+}
+
 static int
-processUtf8Line (char *line, void *dataAddress) {
-  DataFile *file = dataAddress;
-  size_t size = strlen(line) + 1;
-  const char *byte = line;
-  wchar_t characters[size];
-  wchar_t *character = characters;
+testUnusedDataTextCacheEntry (const void *item, const void *data UNUSED) {
+  const DataTextCacheEntry *entry = item;
+
+  return !entry->text->users;
+}
+
+static DataText *
+getCachedDataText (FILE *stream, DataText **uncached) {
+  struct stat status;
+  Queue *cache;
+
+  *uncached = NULL;
+
+  if ((fstat(fileno(stream), &status) != -1) && S_ISREG(status.st_mode) &&
+      (cache = getDataTextCache())) {
+    {
+      Element *element = findElement(cache, testDataTextCacheEntry, &status);
 
-  file->line += 1;
-  convertUtf8ToWchars(&byte, &character, size);
+      if (element) {
+        DataTextCacheEntry *entry = getElementItem(element);
 
-  if (*byte) {
-    unsigned int offset = byte - line;
-    reportDataError(file, "illegal UTF-8 character at offset %u", offset);
-    return 1;
+        requeueElement(element);
+        return entry->text;
+      }
+    }
+
+    {
+      DataText *text = readDataText(stream);
+      if (!text) return NULL;
+
+      if (text->size <= DATA_TEXT_CACHE_ENTRY_LIMIT) {
+        DataTextCacheEntry *entry;
+
+        if ((entry = malloc(sizeof(*entry)))) {
+          entry->device = status.st_dev;
+          entry->inode = status.st_ino;
+          entry->size = status.st_size;
+          entry->modified = status.st_mtime;
+          entry->text = text;
+
+          /* texts which are still being processed (by an including file) stay */
+          while ((dataTextCacheSize + text->size) > DATA_TEXT_CACHE_LIMIT) {
+            Element *element = findElement(cache, testUnusedDataTextCacheEntry, NULL);
+
+            if (!element) break;
+            deleteElement(element);
+          }
+
+          if (enqueueItem(cache, entry)) {
+            dataTextCacheSize += text->size;
+            return text;
+          }
+
+          free(entry);
+        } else {
+          logMallocError();
+        }
+      }
+
+      return *uncached = text;
+    }
   }
 
-  return processWcharLine(file, characters);
+  return *uncached = readDataText(stream);
 }
 
-int
-processDataStream (
-  Queue *variables,
-  FILE *stream, const char *name,
+static int
+processDataText (
+  DataVariables *variables,
+  DataText *text, const char *name,
   DataProcessor processor, void *data
 ) {
   int ok = 0;
@@ -982,23 +1332,74 @@ processDataStream (
       return 0;
 
   logMessage(LOG_DEBUG, "including data file: %s", file.name);
-  if ((file.variables = newDataVariableQueue(variables))) {
-    if (processLines(stream, processUtf8Line, &file)) ok = 1;
-    deallocateQueue(file.variables);
+  if ((file.variables = newDataVariables(variables))) {
+    const DataLine *line = text->lines;
+    const DataLine *end = line + text->count;
+
+    text->users += 1;
+
+    while (line < end) {
+      file.line += 1;
+
+      if (line->error) {
+        reportDataError(&file, "illegal UTF-8 character at offset %u", line->error-1);
+      } else if (!processWcharLine(&file, &text->characters[line->offset])) {
+        break;
+      }
+
+      line += 1;
+    }
+
+    text->users -= 1;
+    deallocateDataVariables(file.variables);
+    ok = 1;
   }
 
   return ok;
 }
 
 int
-processDataFile (const char *name, DataProcessor processor, void *data) {
+processDataStream (
+  DataVariables *variables,
+  FILE *stream, const char *name,
+  DataProcessor processor, void *data
+) {
+  int ok = 0;
+  DataText *text = readDataText(stream);
+
+  if (text) {
+    if (processDataText(variables, text, name, processor, data)) ok = 1;
+    deallocateDataText(text);
+  }
+
+  return ok;
+}
+
+static int
+processDataPath (
+  DataVariables *variables,
+  const char *path,
+  DataProcessor processor, void *data
+) {
   int ok = 0;
   FILE *stream;
 
-  if ((stream = openDataFile(name, "r", 0))) {
-    if (processDataStream(NULL, stream, name, processor, data)) ok = 1;
+  if ((stream = openDataFile(path, "r", 0))) {
+    DataText *uncached;
+    DataText *text = getCachedDataText(stream, &uncached);
+
     fclose(stream);
+
+    if (text) {
+      if (processDataText(variables, text, path, processor, data)) ok = 1;
+      if (uncached) deallocateDataText(uncached);
+    }
   }
 
   return ok;
 }
+
+int
+processDataFile (const char *name, DataProcessor processor, void *data) {
+  return processDataPath(NULL, name, processor, data);
+}
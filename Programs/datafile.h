@@ -37,8 +37,10 @@ typedef int DataProcessor (DataFile *file, void *data);
 extern int processDataFile (const char *name, DataProcessor processor, void *data);
 extern void reportDataError (DataFile *file, char *format, ...) PRINTF(2, 3);
 
+typedef struct DataVariablesStruct DataVariables;
+
 extern int processDataStream (
-  Queue *variables,
+  DataVariables *variables,
   FILE *stream, const char *name,
   DataProcessor processor, void *data
 );
@@ -19,6 +19,8 @@
 #ifndef BRLTTY_INCLUDED_IO_BLUETOOTH
 #define BRLTTY_INCLUDED_IO_BLUETOOTH
 
+#include "async.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -39,6 +41,10 @@ extern ssize_t bthReadData (
   int initialTimeout, int subsequentTimeout
 );
 
+/* Invokes the callback from the async event loop whenever input arrives,
+ * a null callback stops monitoring */
+extern int bthMonitorInput (BluetoothConnection *connection, AsyncMonitorCallback callback, void *data);
+
 extern ssize_t bthWriteData (BluetoothConnection *conection, const void *buffer, size_t size);
 
 extern int isBluetoothDevice (const char **identifier);
@@ -0,0 +1,406 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2013 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://mielke.cc/brltty/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+#include "timing.h"
+#include "bitfield.h"
+#include "device.h"
+#include "io_capture.h"
+
+#define GIO_CAPTURE_FLUSH_INTERVAL 1000
+
+static FILE *captureFile = NULL;
+static TimeValue captureStarted;
+static TimeValue captureFlushed;
+static unsigned char captureEndpoint;
+
+int
+gioStartCapture (const char *path) {
+  gioStopCapture();
+
+  if ((captureFile = fopen(path, "wb"))) {
+    if (fwrite(GIO_CAPTURE_MAGIC, 1, GIO_CAPTURE_MAGIC_SIZE, captureFile) == GIO_CAPTURE_MAGIC_SIZE) {
+      getMonotonicTime(&captureStarted);
+      captureFlushed = captureStarted;
+      captureEndpoint = 0;
+
+      logMessage(LOG_INFO, "capturing generic I/O: %s", path);
+      return 1;
+    }
+
+    logSystemError("fwrite");
+    fclose(captureFile);
+    captureFile = NULL;
+  } else {
+    logMessage(LOG_WARNING, "cannot open capture file: %s: %s",
+               path, strerror(errno));
+  }
+
+  return 0;
+}
+
+void
+gioStopCapture (void) {
+  if (captureFile) {
+    if (fclose(captureFile) == EOF) logSystemError("fclose");
+    captureFile = NULL;
+  }
+}
+
+static void
+writeCaptureRecord (
+  unsigned char endpoint, GioCaptureType type,
+  const void *data, size_t size
+) {
+  const unsigned char *bytes = data;
+  TimeValue now;
+  GioCaptureHeader header;
+
+  getMonotonicTime(&now);
+
+  {
+    int32_t seconds = now.seconds - captureStarted.seconds;
+    int32_t nanoseconds = now.nanoseconds - captureStarted.nanoseconds;
+
+    if (nanoseconds < 0) {
+      nanoseconds += NSECS_PER_SEC;
+      seconds -= 1;
+    }
+
+    putLittleEndian32(&header.seconds, seconds);
+    putLittleEndian32(&header.nanoseconds, nanoseconds);
+  }
+
+  header.type = type;
+  header.endpoint = endpoint;
+
+  do {
+    size_t count = size;
+
+    if (count > UINT16_MAX) count = UINT16_MAX;
+    putLittleEndian16(&header.length, count);
+
+    if ((fwrite(&header, sizeof(header), 1, captureFile) != 1) ||
+        (fwrite(bytes, 1, count, captureFile) != count)) {
+      logSystemError("fwrite");
+      gioStopCapture();
+      return;
+    }
+
+    bytes += count;
+    size -= count;
+  } while (size);
+
+  if ((type == GIO_CAPTURE_DISCONNECT) ||
+      (millisecondsBetween(&captureFlushed, &now) >= GIO_CAPTURE_FLUSH_INTERVAL)) {
+    fflush(captureFile);
+    captureFlushed = now;
+  }
+}
+
+unsigned char
+gioCaptureConnect (const char *identifier) {
+  if (!captureFile) return 0;
+  if (!++captureEndpoint) captureEndpoint = 1;
+
+  writeCaptureRecord(captureEndpoint, GIO_CAPTURE_CONNECT,
+                     identifier, strlen(identifier));
+  return captureEndpoint;
+}
+
+void
+gioCaptureData (
+  unsigned char endpoint, GioCaptureType type,
+  const void *data, size_t size
+) {
+  if (captureFile && endpoint) {
+    writeCaptureRecord(endpoint, type, data, size);
+  }
+}
+
+typedef struct {
+  size_t offset;
+  size_t used;
+} GioReplayCursor;
+
+struct GioReplayStruct {
+  unsigned char *bytes;
+  size_t size;
+
+  unsigned char endpoint;
+  char *identifier;
+
+  GioReplayCursor cursors[GIO_CAPTURE_HID_ITEMS + 1];
+};
+
+int
+isReplayResource (const char **identifier) {
+  return isQualifiedDevice(identifier, "replay");
+}
+
+static int
+getReplayRecord (
+  const GioReplay *replay, size_t offset,
+  GioCaptureHeader *header, size_t *length
+) {
+  if ((replay->size - offset) < sizeof(*header)) return 0;
+  memcpy(header, &replay->bytes[offset], sizeof(*header));
+  offset += sizeof(*header);
+
+  *length = getLittleEndian16(header->length);
+  if ((replay->size - offset) < *length) return 0;
+  return 1;
+}
+
+static int
+readReplayFile (GioReplay *replay, const char *path) {
+  FILE *file;
+
+  if ((file = fopen(path, "rb"))) {
+    int ok = 0;
+    size_t size = 0;
+    size_t allocated = 0;
+    unsigned char *bytes = NULL;
+
+    while (1) {
+      size_t count;
+
+      if (size == allocated) {
+        size_t newAllocated = allocated? (allocated << 1): 0X10000;
+        unsigned char *newBytes = realloc(bytes, newAllocated);
+
+        if (!newBytes) {
+          logMallocError();
+          break;
+        }
+
+        bytes = newBytes;
+        allocated = newAllocated;
+      }
+
+      count = fread(&bytes[size], 1, allocated-size, file);
+      size += count;
+
+      if (size < allocated) {
+        if (ferror(file)) {
+          logSystemError("fread");
+        } else {
+          ok = 1;
+        }
+
+        break;
+      }
+    }
+
+    fclose(file);
+
+    if (ok) {
+      replay->bytes = bytes;
+      replay->size = size;
+      return 1;
+    }
+
+    if (bytes) free(bytes);
+  } else {
+    logMessage(LOG_WARNING, "cannot open capture file: %s: %s",
+               path, strerror(errno));
+  }
+
+  return 0;
+}
+
+GioReplay *
+gioOpenReplay (const char *path) {
+  GioReplay *replay;
+
+  if ((replay = malloc(sizeof(*replay)))) {
+    memset(replay, 0, sizeof(*replay));
+
+    if (readReplayFile(replay, path)) {
+      if ((replay->size >= GIO_CAPTURE_MAGIC_SIZE) &&
+          (memcmp(replay->bytes, GIO_CAPTURE_MAGIC, GIO_CAPTURE_MAGIC_SIZE) == 0)) {
+        size_t offset = GIO_CAPTURE_MAGIC_SIZE;
+        GioCaptureHeader header;
+        size_t length;
+
+        while (getReplayRecord(replay, offset, &header, &length)) {
+          offset += sizeof(header) + length;
+
+          if (header.type == GIO_CAPTURE_CONNECT) {
+            unsigned int index;
+
+            if (!(replay->identifier = malloc(length + 1))) {
+              logMallocError();
+              break;
+            }
+
+            memcpy(replay->identifier, &replay->bytes[offset - length], length);
+            replay->identifier[length] = 0;
+            replay->endpoint = header.endpoint;
+
+            logMessage(LOG_DEBUG, "replaying endpoint %u: %s",
+                       replay->endpoint, replay->identifier);
+
+            for (index=0; index<ARRAY_COUNT(replay->cursors); index+=1) {
+              GioReplayCursor *cursor = &replay->cursors[index];
+
+              cursor->offset = offset;
+              cursor->used = 0;
+            }
+
+            return replay;
+          }
+        }
+
+        if (!replay->identifier) {
+          logMessage(LOG_WARNING, "no connection in capture file: %s", path);
+        }
+      } else {
+        logMessage(LOG_WARNING, "not a capture file: %s", path);
+      }
+
+      free(replay->bytes);
+    }
+
+    free(replay);
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+void
+gioCloseReplay (GioReplay *replay) {
+  free(replay->identifier);
+  free(replay->bytes);
+  free(replay);
+}
+
+const char *
+gioGetReplayIdentifier (GioReplay *replay) {
+  return replay->identifier;
+}
+
+static void
+skipReplayRecord (GioReplayCursor *cursor, size_t length) {
+  cursor->offset += sizeof(GioCaptureHeader) + length;
+  cursor->used = 0;
+}
+
+static GioReplayState
+findReplayRecord (
+  GioReplay *replay, GioCaptureType type,
+  const unsigned char **data, size_t *length
+) {
+  GioReplayCursor *cursor = &replay->cursors[type];
+  const GioReplayCursor *output = &replay->cursors[GIO_CAPTURE_OUTPUT];
+  GioCaptureHeader header;
+
+  while (getReplayRecord(replay, cursor->offset, &header, length)) {
+    if (header.endpoint == replay->endpoint) {
+      if (header.type == GIO_CAPTURE_DISCONNECT) break;
+
+      if (header.type == type) {
+        *data = &replay->bytes[cursor->offset + sizeof(header)];
+        return GIO_REPLAY_READY;
+      }
+
+      /* what the device sent after a write mustn't be seen before that write */
+      if ((header.type == GIO_CAPTURE_OUTPUT) && (cursor->offset >= output->offset)) {
+        return GIO_REPLAY_PENDING;
+      }
+    }
+
+    skipReplayRecord(cursor, *length);
+  }
+
+  return GIO_REPLAY_ENDED;
+}
+
+GioReplayState
+gioGetReplayState (GioReplay *replay, GioCaptureType type) {
+  const unsigned char *data;
+  size_t length;
+
+  return findReplayRecord(replay, type, &data, &length);
+}
+
+size_t
+gioGetReplayData (
+  GioReplay *replay, GioCaptureType type,
+  void *buffer, size_t size
+) {
+  GioReplayCursor *cursor = &replay->cursors[type];
+  const unsigned char *data;
+  size_t length;
+
+  if (findReplayRecord(replay, type, &data, &length) != GIO_REPLAY_READY) return 0;
+
+  {
+    size_t count = length - cursor->used;
+
+    if (count > size) count = size;
+    memcpy(buffer, &data[cursor->used], count);
+    cursor->used += count;
+
+    /* input may be read in pieces but each reply answers just one request */
+    if ((type != GIO_CAPTURE_INPUT) || (cursor->used == length)) {
+      skipReplayRecord(cursor, length);
+    }
+
+    return count;
+  }
+}
+
+int
+gioPutReplayOutput (GioReplay *replay, const void *data, size_t size) {
+  GioReplayCursor *cursor = &replay->cursors[GIO_CAPTURE_OUTPUT];
+  const unsigned char *expected;
+  size_t length;
+
+  if (findReplayRecord(replay, GIO_CAPTURE_OUTPUT, &expected, &length) == GIO_REPLAY_READY) {
+    skipReplayRecord(cursor, length);
+    return (size == length) && (memcmp(data, expected, size) == 0);
+  }
+
+  return 0;
+}
+
+GioReplayState
+gioReleaseReplayData (GioReplay *replay, GioCaptureType type) {
+  GioReplayCursor *cursor = &replay->cursors[GIO_CAPTURE_OUTPUT];
+  GioReplayState state;
+
+  /* skip output which the replaying driver isn't going to write */
+  while ((state = gioGetReplayState(replay, type)) == GIO_REPLAY_PENDING) {
+    const unsigned char *data;
+    size_t length;
+
+    if (findReplayRecord(replay, GIO_CAPTURE_OUTPUT, &data, &length) != GIO_REPLAY_READY) break;
+    skipReplayRecord(cursor, length);
+  }
+
+  return state;
+}
@@ -0,0 +1,86 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2013 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://mielke.cc/brltty/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#ifndef BRLTTY_INCLUDED_IO_CAPTURE
+#define BRLTTY_INCLUDED_IO_CAPTURE
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* A capture file begins with GIO_CAPTURE_MAGIC. Each record which follows
+ * it is a header, with all of its fields in little-endian byte order, and
+ * then the number of data bytes given by its length field. The time is
+ * monotonic, and is relative to when the capture was started. Endpoints are
+ * numbered in the order in which they were connected.
+ */
+#define GIO_CAPTURE_MAGIC "brlgio1\n"
+#define GIO_CAPTURE_MAGIC_SIZE (sizeof(GIO_CAPTURE_MAGIC) - 1)
+
+typedef enum {
+  GIO_CAPTURE_CONNECT = 1, /* the resource identifier */
+  GIO_CAPTURE_DISCONNECT,
+  GIO_CAPTURE_INPUT,       /* bytes read from the device */
+  GIO_CAPTURE_OUTPUT,      /* bytes written to the device */
+  GIO_CAPTURE_REPLY,       /* the response to a control or HID request */
+  GIO_CAPTURE_HID_ITEMS    /* the HID report descriptor */
+} GioCaptureType;
+
+typedef struct {
+  uint32_t seconds;
+  uint32_t nanoseconds;
+  uint8_t type;
+  uint8_t endpoint;
+  uint16_t length;
+} GioCaptureHeader;
+
+extern int gioStartCapture (const char *path);
+extern void gioStopCapture (void);
+
+extern unsigned char gioCaptureConnect (const char *identifier);
+extern void gioCaptureData (
+  unsigned char endpoint, GioCaptureType type,
+  const void *data, size_t size
+);
+
+typedef struct GioReplayStruct GioReplay;
+
+extern int isReplayResource (const char **identifier);
+extern GioReplay *gioOpenReplay (const char *path);
+extern void gioCloseReplay (GioReplay *replay);
+extern const char *gioGetReplayIdentifier (GioReplay *replay);
+
+typedef enum {
+  GIO_REPLAY_READY,   /* the next record is available */
+  GIO_REPLAY_PENDING, /* the next record follows output not yet written */
+  GIO_REPLAY_ENDED    /* there are no more records */
+} GioReplayState;
+
+extern GioReplayState gioGetReplayState (GioReplay *replay, GioCaptureType type);
+extern size_t gioGetReplayData (
+  GioReplay *replay, GioCaptureType type,
+  void *buffer, size_t size
+);
+extern int gioPutReplayOutput (GioReplay *replay, const void *data, size_t size);
+extern GioReplayState gioReleaseReplayData (GioReplay *replay, GioCaptureType type);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_IO_CAPTURE */
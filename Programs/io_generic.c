@@ -23,10 +23,12 @@
 
 #include "log.h"
 #include "timing.h"
+#include "async.h"
 #include "io_generic.h"
 #include "io_serial.h"
 #include "io_usb.h"
 #include "io_bluetooth.h"
+#include "io_capture.h"
 
 typedef union {
   struct {
@@ -40,6 +42,14 @@ typedef union {
   struct {
     BluetoothConnection *connection;
   } bluetooth;
+
+  struct {
+    GioReplay *replay;
+    AsyncHandle alarm;
+    AsyncMonitorCallback callback;
+    void *data;
+    unsigned ended:1;
+  } replay;
 } GioHandle;
 
 typedef struct {
@@ -58,6 +68,8 @@ typedef ssize_t ReadDataMethod (
   int initialTimeout, int subsequentTimeout
 );
 
+typedef int MonitorInputMethod (GioHandle *handle, AsyncMonitorCallback callback, void *data);
+
 typedef int ReconfigureResourceMethod (GioHandle *handle, const SerialParameters *parameters);
 
 typedef ssize_t TellResourceMethod (
@@ -102,6 +114,7 @@ typedef struct {
   WriteDataMethod *writeData;
   AwaitInputMethod *awaitInput;
   ReadDataMethod *readData;
+  MonitorInputMethod *monitorInput;
 
   ReconfigureResourceMethod *reconfigureResource;
 
@@ -129,10 +142,26 @@ struct GioEndpointStruct {
     int error;
     unsigned int from;
     unsigned int to;
-    unsigned char buffer[0X40];
+    unsigned char buffer[0X100];
   } input;
+
+  struct {
+    AsyncMonitorCallback callback;
+    void *data;
+    AsyncHandle alarm;
+
+    unsigned int reading;
+    unsigned char monitoring:1;
+    unsigned char deferred:1;
+  } inputMonitor;
+
+  GioStatistics statistics;
+  TimeValue statisticsLogged;
+  unsigned char captureEndpoint;
 };
 
+#define GIO_STATISTICS_LOG_INTERVAL 60000
+
 static void
 initializeOptions (GioOptions *options) {
   options->applicationData = NULL;
@@ -191,6 +220,11 @@ readSerialData (
                         initialTimeout, subsequentTimeout);
 }
 
+static int
+monitorSerialInput (GioHandle *handle, AsyncMonitorCallback callback, void *data) {
+  return serialMonitorInput(handle->serial.device, callback, data);
+}
+
 static int
 reconfigureSerialResource (GioHandle *handle, const SerialParameters *parameters) {
   return serialSetParameters(handle->serial.device, parameters);
@@ -202,6 +236,7 @@ static const InputOutputMethods serialMethods = {
   .writeData = writeSerialData,
   .awaitInput = awaitSerialInput,
   .readData = readSerialData,
+  .monitorInput = monitorSerialInput,
 
   .reconfigureResource = reconfigureSerialResource
 };
@@ -256,6 +291,14 @@ readUsbData (
                      buffer, size, initialTimeout, subsequentTimeout);
 }
 
+static int
+monitorUsbInput (GioHandle *handle, AsyncMonitorCallback callback, void *data) {
+  UsbChannel *channel = handle->usb.channel;
+
+  return usbMonitorInputEndpoint(channel->device, channel->definition.inputEndpoint,
+                                 callback, data);
+}
+
 static int
 reconfigureUsbResource (GioHandle *handle, const SerialParameters *parameters) {
   UsbChannel *channel = handle->usb.channel;
@@ -359,6 +402,7 @@ static const InputOutputMethods usbMethods = {
   .writeData = writeUsbData,
   .awaitInput = awaitUsbInput,
   .readData = readUsbData,
+  .monitorInput = monitorUsbInput,
 
   .reconfigureResource = reconfigureUsbResource,
 
@@ -400,12 +444,246 @@ readBluetoothData (
                      initialTimeout, subsequentTimeout);
 }
 
+static int
+monitorBluetoothInput (GioHandle *handle, AsyncMonitorCallback callback, void *data) {
+  return bthMonitorInput(handle->bluetooth.connection, callback, data);
+}
+
 static const InputOutputMethods bluetoothMethods = {
   .disconnectResource = disconnectBluetoothResource,
 
   .writeData = writeBluetoothData,
   .awaitInput = awaitBluetoothInput,
-  .readData = readBluetoothData
+  .readData = readBluetoothData,
+  .monitorInput = monitorBluetoothInput
+};
+
+static int
+monitorReplayInput (GioHandle *handle, AsyncMonitorCallback callback, void *data);
+
+static int
+disconnectReplayResource (GioHandle *handle) {
+  monitorReplayInput(handle, NULL, NULL);
+  gioCloseReplay(handle->replay.replay);
+  return 1;
+}
+
+static ssize_t
+putReplayOutput (GioHandle *handle, const void *data, size_t size) {
+  if (!gioPutReplayOutput(handle->replay.replay, data, size)) {
+    logBytes(LOG_WARNING, "uncaptured output", data, size);
+  }
+
+  return size;
+}
+
+static ssize_t
+writeReplayData (GioHandle *handle, const void *data, size_t size, int timeout) {
+  return putReplayOutput(handle, data, size);
+}
+
+static int
+awaitReplayInput (GioHandle *handle, int timeout) {
+  /* the end of the capture is reported by the next read */
+  if (gioGetReplayState(handle->replay.replay, GIO_CAPTURE_INPUT) != GIO_REPLAY_PENDING) return 1;
+
+#ifdef ETIMEDOUT
+  errno = ETIMEDOUT;
+#else /* ETIMEDOUT */
+  errno = EAGAIN;
+#endif /* ETIMEDOUT */
+  return 0;
+}
+
+static ssize_t
+readReplayData (
+  GioHandle *handle, void *buffer, size_t size,
+  int initialTimeout, int subsequentTimeout
+) {
+  GioReplay *replay = handle->replay.replay;
+  GioReplayState state;
+
+  /* a driver waits for a response but polls for unsolicited input */
+  if (initialTimeout) {
+    state = gioGetReplayState(replay, GIO_CAPTURE_INPUT);
+  } else {
+    state = gioReleaseReplayData(replay, GIO_CAPTURE_INPUT);
+  }
+
+  switch (state) {
+    case GIO_REPLAY_READY:
+      return gioGetReplayData(replay, GIO_CAPTURE_INPUT, buffer, size);
+
+    case GIO_REPLAY_PENDING:
+      errno = EAGAIN;
+      return 0;
+
+    default:
+      /* the end of the capture looks like the device having gone away */
+      errno = ENODEV;
+      return -1;
+  }
+}
+
+static void
+handleReplayInput (const AsyncAlarmResult *result) {
+  GioHandle *handle = result->data;
+  AsyncMonitorCallback callback = handle->replay.callback;
+
+  asyncDiscardHandle(handle->replay.alarm);
+  handle->replay.alarm = NULL;
+
+  /* the callback is invoked once more after the last input so that it sees the end */
+  if (gioReleaseReplayData(handle->replay.replay, GIO_CAPTURE_INPUT) != GIO_REPLAY_READY) {
+    if (handle->replay.ended) return;
+    handle->replay.ended = 1;
+  }
+
+  {
+    const AsyncMonitorResult monitor = {
+      .data = handle->replay.data
+    };
+
+    if (callback(&monitor)) {
+      if (handle->replay.callback == callback) {
+        if (!asyncSetAlarmIn(&handle->replay.alarm, 0, handleReplayInput, handle)) {
+          handle->replay.alarm = NULL;
+        }
+      }
+    } else if (handle->replay.callback == callback) {
+      handle->replay.callback = NULL;
+    }
+  }
+}
+
+static int
+monitorReplayInput (GioHandle *handle, AsyncMonitorCallback callback, void *data) {
+  if (handle->replay.alarm) {
+    asyncCancelRequest(handle->replay.alarm);
+    handle->replay.alarm = NULL;
+  }
+
+  handle->replay.callback = callback;
+  handle->replay.data = data;
+
+  if (callback) {
+    if (!asyncSetAlarmIn(&handle->replay.alarm, 0, handleReplayInput, handle)) {
+      handle->replay.alarm = NULL;
+      handle->replay.callback = NULL;
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+static int
+reconfigureReplayResource (GioHandle *handle, const SerialParameters *parameters) {
+  return 1;
+}
+
+static ssize_t
+getReplayReply (GioHandle *handle, void *buffer, uint16_t size) {
+  switch (gioGetReplayState(handle->replay.replay, GIO_CAPTURE_REPLY)) {
+    case GIO_REPLAY_READY:
+      return gioGetReplayData(handle->replay.replay, GIO_CAPTURE_REPLY, buffer, size);
+
+    case GIO_REPLAY_PENDING:
+      errno = EAGAIN;
+      return -1;
+
+    default:
+      errno = ENODEV;
+      return -1;
+  }
+}
+
+static ssize_t
+tellReplayResource (
+  GioHandle *handle, uint8_t recipient, uint8_t type,
+  uint8_t request, uint16_t value, uint16_t index,
+  const void *data, uint16_t size, int timeout
+) {
+  return putReplayOutput(handle, data, size);
+}
+
+static ssize_t
+askReplayResource (
+  GioHandle *handle, uint8_t recipient, uint8_t type,
+  uint8_t request, uint16_t value, uint16_t index,
+  void *buffer, uint16_t size, int timeout
+) {
+  return getReplayReply(handle, buffer, size);
+}
+
+static int
+getReplayHidReportItems (GioHandle *handle, HidReportItemsData *items, int timeout) {
+  GioReplay *replay = handle->replay.replay;
+
+  if (gioGetReplayState(replay, GIO_CAPTURE_HID_ITEMS) == GIO_REPLAY_READY) {
+    unsigned char *address;
+
+    if ((address = malloc(UINT16_MAX))) {
+      size_t size = gioGetReplayData(replay, GIO_CAPTURE_HID_ITEMS, address, UINT16_MAX);
+
+      {
+        unsigned char *newAddress = realloc(address, size);
+        if (newAddress) address = newAddress;
+      }
+
+      items->address = address;
+      items->size = size;
+      return 1;
+    } else {
+      logMallocError();
+    }
+  }
+
+  return 0;
+}
+
+static size_t
+getReplayHidReportSize (const HidReportItemsData *items, unsigned char report) {
+  return getUsbHidReportSize(items, report);
+}
+
+static ssize_t
+setReplayHidReport (
+  GioHandle *handle, unsigned char report,
+  const void *data, uint16_t size, int timeout
+) {
+  return putReplayOutput(handle, data, size);
+}
+
+static ssize_t
+getReplayHidReport (
+  GioHandle *handle, unsigned char report,
+  void *buffer, uint16_t size, int timeout
+) {
+  return getReplayReply(handle, buffer, size);
+}
+
+static const InputOutputMethods replayMethods = {
+  .disconnectResource = disconnectReplayResource,
+
+  .writeData = writeReplayData,
+  .awaitInput = awaitReplayInput,
+  .readData = readReplayData,
+  .monitorInput = monitorReplayInput,
+
+  .reconfigureResource = reconfigureReplayResource,
+
+  .tellResource = tellReplayResource,
+  .askResource = askReplayResource,
+
+  .getHidReportItems = getReplayHidReportItems,
+  .getHidReportSize = getReplayHidReportSize,
+
+  .setHidReport = setReplayHidReport,
+  .getHidReport = getReplayHidReport,
+
+  .setHidFeature = setReplayHidReport,
+  .getHidFeature = getReplayHidReport
 };
 
 static void
@@ -413,23 +691,78 @@ setBytesPerSecond (GioEndpoint *endpoint, const SerialParameters *parameters) {
   endpoint->bytesPerSecond = parameters->baud / serialGetCharacterSize(parameters);
 }
 
+static void
+captureData (GioEndpoint *endpoint, GioCaptureType type, const void *data, ssize_t size) {
+  if (endpoint->captureEndpoint && (size >= 0)) {
+    gioCaptureData(endpoint->captureEndpoint, type, data, size);
+  }
+}
+
 GioEndpoint *
 gioConnectResource (
   const char *identifier,
   const GioDescriptor *descriptor
 ) {
+  const char *resource = identifier;
   GioEndpoint *endpoint;
 
   if ((endpoint = malloc(sizeof(*endpoint)))) {
     endpoint->bytesPerSecond = 0;
+    endpoint->captureEndpoint = 0;
 
     endpoint->input.error = 0;
     endpoint->input.from = 0;
     endpoint->input.to = 0;
 
+    endpoint->inputMonitor.callback = NULL;
+    endpoint->inputMonitor.data = NULL;
+    endpoint->inputMonitor.alarm = NULL;
+    endpoint->inputMonitor.reading = 0;
+    endpoint->inputMonitor.monitoring = 0;
+    endpoint->inputMonitor.deferred = 0;
+
     endpoint->hidReportItems.address = NULL;
     endpoint->hidReportItems.size = 0;
 
+    memset(&endpoint->statistics, 0, sizeof(endpoint->statistics));
+    getMonotonicTime(&endpoint->statistics.started);
+    endpoint->statisticsLogged = endpoint->statistics.started;
+
+    if (isReplayResource(&identifier)) {
+      if ((endpoint->handle.replay.replay = gioOpenReplay(identifier))) {
+        const char *captured = gioGetReplayIdentifier(endpoint->handle.replay.replay);
+
+        endpoint->handle.replay.alarm = NULL;
+        endpoint->handle.replay.callback = NULL;
+        endpoint->handle.replay.data = NULL;
+        endpoint->handle.replay.ended = 0;
+        endpoint->methods = &replayMethods;
+
+        /* use the options which the driver gave for the captured resource type */
+        if (descriptor->serial.parameters && isSerialDevice(&captured)) {
+          endpoint->options = descriptor->serial.options;
+          setBytesPerSecond(endpoint, descriptor->serial.parameters);
+        } else if (descriptor->usb.channelDefinitions && isUsbDevice(&captured)) {
+          endpoint->options = descriptor->usb.options;
+
+          if (!endpoint->options.applicationData) {
+            endpoint->options.applicationData = descriptor->usb.channelDefinitions->data;
+          }
+        } else if (descriptor->bluetooth.channelNumber && isBluetoothDevice(&captured)) {
+          endpoint->options = descriptor->bluetooth.options;
+        } else {
+          logMessage(LOG_WARNING, "captured resource not supported by driver: %s",
+                     gioGetReplayIdentifier(endpoint->handle.replay.replay));
+          gioCloseReplay(endpoint->handle.replay.replay);
+          goto connectFailed;
+        }
+
+        goto connectSucceeded;
+      }
+
+      goto connectFailed;
+    }
+
     if (descriptor->serial.parameters) {
       if (isSerialDevice(&identifier)) {
         if ((endpoint->handle.serial.device = serialOpenDevice(identifier))) {
@@ -494,8 +827,11 @@ gioConnectResource (
   return NULL;
 
 connectSucceeded:
+  endpoint->captureEndpoint = gioCaptureConnect(resource);
+
   {
     int delay = endpoint->options.readyDelay;
+    if (endpoint->methods == &replayMethods) delay = 0;
     if (delay) approximateDelay(delay);
   }
 
@@ -514,6 +850,17 @@ gioDisconnectResource (GioEndpoint *endpoint) {
   int ok = 0;
   DisconnectResourceMethod *method = endpoint->methods->disconnectResource;
 
+  if (endpoint->inputMonitor.alarm) {
+    asyncCancelRequest(endpoint->inputMonitor.alarm);
+    endpoint->inputMonitor.alarm = NULL;
+  }
+
+  if (LOG_CATEGORY_FLAG(GENERIC_STATISTICS)) {
+    gioLogStatistics(endpoint, LOG_CATEGORY(GENERIC_STATISTICS));
+  }
+
+  captureData(endpoint, GIO_CAPTURE_DISCONNECT, NULL, 0);
+
   if (!method) {
     logUnsupportedOperation("disconnectResource");
   } else if (method(&endpoint->handle)) {
@@ -530,6 +877,88 @@ gioGetApplicationData (GioEndpoint *endpoint) {
   return endpoint->options.applicationData;
 }
 
+GioStatistics *
+gioGetStatistics (GioEndpoint *endpoint) {
+  return &endpoint->statistics;
+}
+
+void
+gioAddToHistogram (GioHistogram *histogram, long int milliseconds) {
+  unsigned int bucket = 0;
+
+  if (milliseconds < 0) milliseconds = 0;
+  if ((unsigned long)milliseconds > histogram->maximum) histogram->maximum = milliseconds;
+  histogram->count += 1;
+
+  while (milliseconds) {
+    if (++bucket == (GIO_HISTOGRAM_SIZE - 1)) break;
+    milliseconds >>= 1;
+  }
+
+  histogram->buckets[bucket] += 1;
+}
+
+static void
+logHistogram (int level, const char *label, const GioHistogram *histogram) {
+  char buffer[0X200];
+  unsigned int bucket;
+
+  STR_BEGIN(buffer, sizeof(buffer));
+  STR_PRINTF("%s: %lu, max %lums", label, histogram->count, histogram->maximum);
+
+  for (bucket=0; bucket<GIO_HISTOGRAM_SIZE; bucket+=1) {
+    unsigned long count = histogram->buckets[bucket];
+
+    if (count) {
+      unsigned long from = bucket? (1UL << (bucket - 1)): 0;
+
+      STR_PRINTF(" %lu%s:%lu", from,
+                 ((bucket == (GIO_HISTOGRAM_SIZE - 1))? "+": ""), count);
+    }
+  }
+  STR_END
+
+  logMessage(level, "%s", buffer);
+}
+
+void
+gioLogStatistics (GioEndpoint *endpoint, int level) {
+  const GioStatistics *statistics = &endpoint->statistics;
+  long int seconds = getMonotonicElapsed(&statistics->started) / 1000;
+
+  if (seconds < 1) seconds = 1;
+
+  logMessage(level,
+             "input: %lu bytes (%lu/s), %lu reads, %lu short, %lu timeouts, %lu errors",
+             statistics->input.bytes, statistics->input.bytes/seconds,
+             statistics->input.reads, statistics->input.shortReads,
+             statistics->input.timeouts, statistics->input.errors);
+
+  logMessage(level,
+             "input packets: %lu (%lu/s), %lu partial, %lu corrupt",
+             statistics->input.packets, statistics->input.packets/seconds,
+             statistics->input.partialPackets, statistics->input.corruptPackets);
+
+  logMessage(level,
+             "output: %lu bytes (%lu/s), %lu writes, %lu errors, %lu packets (%lu/s)",
+             statistics->output.bytes, statistics->output.bytes/seconds,
+             statistics->output.writes, statistics->output.errors,
+             statistics->output.packets, statistics->output.packets/seconds);
+
+  logHistogram(level, "input packet assembly time", &statistics->input.packetAssemblyTime);
+  logHistogram(level, "output write latency", &statistics->output.writeLatency);
+}
+
+static void
+checkStatistics (GioEndpoint *endpoint) {
+  if (LOG_CATEGORY_FLAG(GENERIC_STATISTICS)) {
+    if (getMonotonicElapsed(&endpoint->statisticsLogged) >= GIO_STATISTICS_LOG_INTERVAL) {
+      gioLogStatistics(endpoint, LOG_CATEGORY(GENERIC_STATISTICS));
+      getMonotonicTime(&endpoint->statisticsLogged);
+    }
+  }
+}
+
 ssize_t
 gioWriteData (GioEndpoint *endpoint, const void *data, size_t size) {
   WriteDataMethod *method = endpoint->methods->writeData;
@@ -539,8 +968,27 @@ gioWriteData (GioEndpoint *endpoint, const void *data, size_t size) {
     return -1;
   }
 
-  return method(&endpoint->handle, data, size,
-                endpoint->options.outputTimeout);
+  {
+    GioStatistics *statistics = &endpoint->statistics;
+    TimeValue start;
+    ssize_t result;
+
+    getMonotonicTime(&start);
+    result = method(&endpoint->handle, data, size,
+                    endpoint->options.outputTimeout);
+
+    statistics->output.writes += 1;
+    if (result == -1) {
+      statistics->output.errors += 1;
+    } else {
+      statistics->output.bytes += result;
+      captureData(endpoint, GIO_CAPTURE_OUTPUT, data, result);
+    }
+
+    gioAddToHistogram(&statistics->output.writeLatency, getMonotonicElapsed(&start));
+    checkStatistics(endpoint);
+    return result;
+  }
 }
 
 int
@@ -557,18 +1005,14 @@ gioAwaitInput (GioEndpoint *endpoint, int timeout) {
   return method(&endpoint->handle, timeout);
 }
 
-ssize_t
-gioReadData (GioEndpoint *endpoint, void *buffer, size_t size, int wait) {
-  ReadDataMethod *method = endpoint->methods->readData;
-
-  if (!method) {
-    logUnsupportedOperation("readData");
-    return -1;
-  }
-
+static ssize_t
+readEndpointData (GioEndpoint *endpoint, ReadDataMethod *method, void *buffer, size_t size, int wait) {
   {
+    GioStatistics *statistics = &endpoint->statistics;
     unsigned char *start = buffer;
     unsigned char *next = start;
+    size_t requested = size;
+    int waited = wait;
 
     while (size) {
       {
@@ -605,21 +1049,65 @@ gioReadData (GioEndpoint *endpoint, void *buffer, size_t size, int wait) {
             logBytes(categoryLogLevel, "generic input", &endpoint->input.buffer[endpoint->input.to], result);
           }
 
+          captureData(endpoint, GIO_CAPTURE_INPUT, &endpoint->input.buffer[endpoint->input.to], result);
+
+          statistics->input.reads += 1;
+          statistics->input.bytes += result;
+
           endpoint->input.to += result;
           wait = 1;
         } else {
           if (!result) break;
           if (errno == EAGAIN) break;
           endpoint->input.error = errno;
+          statistics->input.errors += 1;
         }
       }
     }
 
+    if (waited) {
+      if (next == start) {
+        statistics->input.timeouts += 1;
+      } else if ((next - start) < requested) {
+        statistics->input.shortReads += 1;
+      }
+    }
+
+    checkStatistics(endpoint);
     if (next == start) errno = EAGAIN;
     return next - start;
   }
 }
 
+static int scheduleInputMonitor (GioEndpoint *endpoint);
+
+ssize_t
+gioReadData (GioEndpoint *endpoint, void *buffer, size_t size, int wait) {
+  ReadDataMethod *method = endpoint->methods->readData;
+  ssize_t result;
+
+  if (!method) {
+    logUnsupportedOperation("readData");
+    return -1;
+  }
+
+  /* the input monitor's callback is held back until the read is done */
+  endpoint->inputMonitor.reading += 1;
+  result = readEndpointData(endpoint, method, buffer, size, wait);
+
+  if (!(endpoint->inputMonitor.reading -= 1)) {
+    if (endpoint->inputMonitor.deferred) {
+      int error = errno;
+
+      endpoint->inputMonitor.deferred = 0;
+      scheduleInputMonitor(endpoint);
+      errno = error;
+    }
+  }
+
+  return result;
+}
+
 int
 gioReadByte (GioEndpoint *endpoint, unsigned char *byte, int wait) {
   ssize_t result = gioReadData(endpoint, byte, 1, wait);
@@ -628,9 +1116,129 @@ gioReadByte (GioEndpoint *endpoint, unsigned char *byte, int wait) {
   return 0;
 }
 
+static int
+invokeInputMonitor (GioEndpoint *endpoint) {
+  AsyncMonitorCallback callback = endpoint->inputMonitor.callback;
+
+  if (callback) {
+    const AsyncMonitorResult result = {
+      .data = endpoint->inputMonitor.data
+    };
+
+    int ok;
+
+    endpoint->inputMonitor.reading += 1;
+    ok = callback(&result);
+    endpoint->inputMonitor.reading -= 1;
+
+    if (ok) return 1;
+    endpoint->inputMonitor.callback = NULL;
+  }
+
+  return 0;
+}
+
+static int startInputMonitor (GioEndpoint *endpoint);
+
+static void
+handleInputMonitorAlarm (const AsyncAlarmResult *result) {
+  GioEndpoint *endpoint = result->data;
+
+  asyncDiscardHandle(endpoint->inputMonitor.alarm);
+  endpoint->inputMonitor.alarm = NULL;
+
+  if (endpoint->inputMonitor.reading) {
+    endpoint->inputMonitor.deferred = 1;
+    return;
+  }
+
+  if (!invokeInputMonitor(endpoint)) {
+    gioMonitorInput(endpoint, NULL, NULL);
+    return;
+  }
+
+  if (endpoint->inputMonitor.callback && !endpoint->inputMonitor.monitoring) {
+    if (!startInputMonitor(endpoint)) {
+      logMessage(LOG_WARNING, "input monitor not restarted");
+      endpoint->inputMonitor.callback = NULL;
+      endpoint->inputMonitor.data = NULL;
+    }
+  }
+}
+
+static int
+scheduleInputMonitor (GioEndpoint *endpoint) {
+  if (endpoint->inputMonitor.alarm) return 1;
+  if (asyncSetAlarmIn(&endpoint->inputMonitor.alarm, 0, handleInputMonitorAlarm, endpoint)) return 1;
+
+  endpoint->inputMonitor.alarm = NULL;
+  return 0;
+}
+
+static int
+handleMonitoredInput (const AsyncMonitorResult *result) {
+  GioEndpoint *endpoint = result->data;
+
+  /* The callback is invoked from an alarm, with the monitor stopped,
+   * so that the synchronous reads it does can wait for the endpoint
+   * and so that it can't be reentered. The monitor is restarted
+   * once the callback (and any read which is under way) is done.
+   */
+  if (!scheduleInputMonitor(endpoint)) return 1;
+
+  endpoint->inputMonitor.monitoring = 0;
+  return 0;
+}
+
+static int
+startInputMonitor (GioEndpoint *endpoint) {
+  MonitorInputMethod *method = endpoint->methods->monitorInput;
+
+  if (!method(&endpoint->handle, handleMonitoredInput, endpoint)) return 0;
+  endpoint->inputMonitor.monitoring = 1;
+
+  /* input which has already been read in won't be signalled again */
+  if (endpoint->input.to - endpoint->input.from) scheduleInputMonitor(endpoint);
+
+  return 1;
+}
+
+int
+gioMonitorInput (GioEndpoint *endpoint, AsyncMonitorCallback callback, void *data) {
+  MonitorInputMethod *method = endpoint->methods->monitorInput;
+
+  if (!method) {
+    logUnsupportedOperation("monitorInput");
+    return 0;
+  }
+
+  if (endpoint->inputMonitor.alarm) {
+    asyncCancelRequest(endpoint->inputMonitor.alarm);
+    endpoint->inputMonitor.alarm = NULL;
+  }
+
+  endpoint->inputMonitor.callback = NULL;
+  endpoint->inputMonitor.data = NULL;
+  endpoint->inputMonitor.monitoring = 0;
+  endpoint->inputMonitor.deferred = 0;
+
+  if (!callback) return method(&endpoint->handle, NULL, NULL);
+
+  endpoint->inputMonitor.callback = callback;
+  endpoint->inputMonitor.data = data;
+  if (startInputMonitor(endpoint)) return 1;
+
+  endpoint->inputMonitor.callback = NULL;
+  endpoint->inputMonitor.data = NULL;
+  return 0;
+}
+
 int
 gioDiscardInput (GioEndpoint *endpoint) {
   unsigned char byte;
+
+  /* captured input is replayed in order and mustn't be thrown away */
+  if (endpoint->methods == &replayMethods) return 1;
   while (gioReadByte(endpoint, &byte, 0));
   return errno == EAGAIN;
 }
@@ -677,9 +1285,14 @@ gioTellResource (
     return -1;
   }
 
-  return method(&endpoint->handle, recipient, type,
-                request, value, index, data, size,
-                endpoint->options.outputTimeout);
+  {
+    ssize_t result = method(&endpoint->handle, recipient, type,
+                            request, value, index, data, size,
+                            endpoint->options.outputTimeout);
+
+    captureData(endpoint, GIO_CAPTURE_OUTPUT, data, result);
+    return result;
+  }
 }
 
 ssize_t
@@ -696,9 +1309,14 @@ gioAskResource (
     return -1;
   }
 
-  return method(&endpoint->handle, recipient, type,
-                request, value, index, buffer, size,
-                endpoint->options.inputTimeout);
+  {
+    ssize_t result = method(&endpoint->handle, recipient, type,
+                            request, value, index, buffer, size,
+                            endpoint->options.inputTimeout);
+
+    captureData(endpoint, GIO_CAPTURE_REPLY, buffer, result);
+    return result;
+  }
 }
 
 size_t
@@ -715,6 +1333,10 @@ gioGetHidReportSize (GioEndpoint *endpoint, unsigned char report) {
                 endpoint->options.inputTimeout)) {
       return 0;
     }
+
+    captureData(endpoint, GIO_CAPTURE_HID_ITEMS,
+                endpoint->hidReportItems.address,
+                endpoint->hidReportItems.size);
   }
 
   {
@@ -741,8 +1363,13 @@ gioSetHidReport (
     return -1;
   }
 
-  return method(&endpoint->handle, report,
-                data, size, endpoint->options.outputTimeout);
+  {
+    ssize_t result = method(&endpoint->handle, report,
+                            data, size, endpoint->options.outputTimeout);
+
+    captureData(endpoint, GIO_CAPTURE_OUTPUT, data, result);
+    return result;
+  }
 }
 
 ssize_t
@@ -757,8 +1384,13 @@ gioGetHidReport (
     return -1;
   }
 
-  return method(&endpoint->handle, report,
-                buffer, size, endpoint->options.inputTimeout);
+  {
+    ssize_t result = method(&endpoint->handle, report,
+                            buffer, size, endpoint->options.inputTimeout);
+
+    captureData(endpoint, GIO_CAPTURE_REPLY, buffer, result);
+    return result;
+  }
 }
 
 ssize_t
@@ -773,8 +1405,13 @@ gioSetHidFeature (
     return -1;
   }
 
-  return method(&endpoint->handle, report,
-                data, size, endpoint->options.outputTimeout);
+  {
+    ssize_t result = method(&endpoint->handle, report,
+                            data, size, endpoint->options.outputTimeout);
+
+    captureData(endpoint, GIO_CAPTURE_OUTPUT, data, result);
+    return result;
+  }
 }
 
 ssize_t
@@ -789,6 +1426,11 @@ gioGetHidFeature (
     return -1;
   }
 
-  return method(&endpoint->handle, report,
-                buffer, size, endpoint->options.inputTimeout);
+  {
+    ssize_t result = method(&endpoint->handle, report,
+                            buffer, size, endpoint->options.inputTimeout);
+
+    captureData(endpoint, GIO_CAPTURE_REPLY, buffer, result);
+    return result;
+  }
 }
@@ -21,6 +21,8 @@
 
 #include "serialdefs.h"
 #include "usbdefs.h"
+#include "async.h"
+#include "timing.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -66,6 +68,12 @@ extern ssize_t gioWriteData (GioEndpoint *endpoint, const void *data, size_t siz
 extern int gioAwaitInput (GioEndpoint *endpoint, int timeout);
 extern ssize_t gioReadData (GioEndpoint *endpoint, void *buffer, size_t size, int wait);
 extern int gioReadByte (GioEndpoint *endpoint, unsigned char *byte, int wait);
+
+/* Invokes the callback from the async event loop as soon as input arrives.
+ * It should read (e.g. with gioReadData) until no more input is available,
+ * and return 0 to stop being called. A null callback stops monitoring.
+ */
+extern int gioMonitorInput (GioEndpoint *endpoint, AsyncMonitorCallback callback, void *data);
 extern int gioDiscardInput (GioEndpoint *endpoint);
 
 extern int gioReconfigureResource (
@@ -73,6 +81,47 @@ extern int gioReconfigureResource (
   const SerialParameters *parameters
 );
 
+/* Latencies are counted in buckets which double in width:
+ * 0ms, 1ms, 2-3ms, 4-7ms, ... and the last one holds everything longer.
+ */
+#define GIO_HISTOGRAM_SIZE 16
+
+typedef struct {
+  unsigned long count;
+  unsigned long maximum;
+  unsigned long buckets[GIO_HISTOGRAM_SIZE];
+} GioHistogram;
+
+typedef struct {
+  TimeValue started;
+
+  struct {
+    unsigned long bytes;
+    unsigned long reads;
+    unsigned long shortReads;
+    unsigned long timeouts;
+    unsigned long errors;
+
+    unsigned long packets;
+    unsigned long partialPackets;
+    unsigned long corruptPackets;
+    GioHistogram packetAssemblyTime; /* first byte to complete packet */
+  } input;
+
+  struct {
+    unsigned long bytes;
+    unsigned long writes;
+    unsigned long errors;
+
+    unsigned long packets;
+    GioHistogram writeLatency;
+  } output;
+} GioStatistics;
+
+extern GioStatistics *gioGetStatistics (GioEndpoint *endpoint);
+extern void gioAddToHistogram (GioHistogram *histogram, long int milliseconds);
+extern void gioLogStatistics (GioEndpoint *endpoint, int level);
+
 extern unsigned int gioGetBytesPerSecond (GioEndpoint *endpoint);
 extern unsigned int gioGetMillisecondsToTransfer (GioEndpoint *endpoint, size_t bytes);
 
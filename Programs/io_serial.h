@@ -22,6 +22,7 @@
 #include <stdio.h>
 
 #include "serialdefs.h"
+#include "async.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +51,10 @@ extern ssize_t serialReadData (
   int initialTimeout, int subsequentTimeout
 );
 
+/* Invokes the callback from the async event loop whenever input arrives,
+ * a null callback stops monitoring */
+extern int serialMonitorInput (SerialDevice *serial, AsyncMonitorCallback callback, void *data);
+
 extern int serialReadChunk (
   SerialDevice *serial,
   void *buffer, size_t *offset, size_t count,
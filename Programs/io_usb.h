@@ -21,6 +21,7 @@
 
 #include "prologue.h"
 #include "usbdefs.h"
+#include "async.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +38,7 @@ extern int usbDisableAutosuspend (UsbDevice *device);
 
 extern const UsbDeviceDescriptor *usbDeviceDescriptor (UsbDevice *device);
 #define USB_IS_PRODUCT(descriptor,vendor,product) ((getLittleEndian16((descriptor)->idVendor) == (vendor)) && (getLittleEndian16((descriptor)->idProduct) == (product)))
+extern const char *const *usbGetDriverCodes (uint16_t vendor, uint16_t product);
 
 extern int usbNextDescriptor (
   UsbDevice *device,
@@ -202,6 +204,14 @@ extern int usbAwaitInput (
   unsigned char endpointNumber,
   int timeout
 );
+/* Invokes the callback from the async event loop whenever input requests
+ * on the endpoint complete, a null callback stops monitoring */
+extern int usbMonitorInputEndpoint (
+  UsbDevice *device,
+  unsigned char endpointNumber,
+  AsyncMonitorCallback callback,
+  void *data
+);
 extern ssize_t usbReadData (
   UsbDevice *device,
   unsigned char endpointNumber,
@@ -299,6 +309,7 @@ typedef struct {
   int (*setDtrState) (UsbDevice *device, int state);
   int (*setRtsState) (UsbDevice *device, int state);
   int (*enableAdapter) (UsbDevice *device);
+  int (*setLowLatency) (UsbDevice *device);
   ssize_t (*writeData) (UsbDevice *device, const void *data, size_t size);
 } UsbSerialOperations;
 
@@ -23,6 +23,7 @@
 #include <errno.h>
 
 #include "log.h"
+#include "keytrace.h"
 #include "system_linux.h"
 
 #include "keyboard.h"
@@ -41,6 +42,8 @@
 
 #include "async.h"
 
+#define KEYBOARD_EVENT_BATCH_SIZE 0X40
+
 typedef struct {
   KeyboardInstanceData *kid;
   int fileDescriptor;
@@ -505,20 +508,35 @@ handleKeyboardEvent (const AsyncInputResult *result) {
     logMessage(LOG_DEBUG, "keyboard end-of-file: fd=%d", kpd->fileDescriptor);
     closeKeyboard(kpd);
   } else {
-    const struct input_event *event = result->buffer;
-
-    if (result->length >= sizeof(*event)) {
+    const struct input_event *const events = result->buffer;
+    const struct input_event *const end = events + (result->length / sizeof(*events));
+    const struct input_event *event = events;
+    const struct input_event *unforwarded = event;
+
+    /* Everything the device has queued (normally at least one whole
+     * SYN_REPORT frame) is handled at once. Runs of events which aren't
+     * key events are passed through to uinput with a single write.
+     */
+    while (event < end) {
       if (event->type == EV_KEY) {
         int release = event->value == 0;
         int press   = event->value == 1;
 
-        if (release || press) handleKeyEvent(kpd->kid, event->code, press);
-      } else {
-        writeInputEvent(event->type, event->code, event->value);
+        if (unforwarded < event) writeInputEvents(unforwarded, event-unforwarded);
+        unforwarded = event + 1;
+
+        if (release || press) {
+          resumeKeyTrace(startKeyTrace());
+          handleKeyEvent(kpd->kid, event->code, press);
+          resumeKeyTrace(0);
+        }
       }
 
-      return sizeof(*event);
+      event += 1;
     }
+
+    if (unforwarded < end) writeInputEvents(unforwarded, end-unforwarded);
+    return (end - events) * sizeof(*events);
   }
 
   return 0;
@@ -573,7 +591,7 @@ monitorKeyboard (int device, KeyboardCommonData *kcd) {
           if (kpd->kid->actualProperties.type) {
             if (checkKeyboardProperties(&kpd->kid->actualProperties, &kcd->requiredProperties)) {
               if (hasInputEvent(device, EV_KEY, KEY_ENTER, KEY_MAX)) {
-                if (asyncReadFile(NULL, device, sizeof(struct input_event),
+                if (asyncReadFile(NULL, device, (sizeof(struct input_event) * KEYBOARD_EVENT_BATCH_SIZE),
                                   handleKeyboardEvent, kpd)) {
   #ifdef EVIOCGRAB
                   ioctl(device, EVIOCGRAB, 1);
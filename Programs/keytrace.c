@@ -0,0 +1,181 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2013 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://mielke.cc/brltty/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+
+#include "prologue.h"
+
+#include <string.h>
+
+#include "log.h"
+#include "timing.h"
+#include "program.h"
+#include "keytrace.h"
+
+/* Key events are traced only when the key latency log category is enabled.
+ * Each event gets a slot in a ring which records when it was captured,
+ * resolved by the key table, executed as a command, and finally shown by
+ * the next braille write. Slots are identified by a sequence number so that
+ * a stale reference to an overwritten slot is simply ignored.
+ */
+
+#define KEY_TRACE_SIZE 0X100
+
+typedef struct {
+  unsigned int identifier;
+  unsigned char stages;
+  TimeValue times[KTR_STAGE_COUNT];
+} KeyTraceEntry;
+
+static KeyTraceEntry keyTraceRing[KEY_TRACE_SIZE];
+static unsigned int keyTraceSequence = 0;
+static unsigned int currentKeyTrace = 0;
+static unsigned int unwrittenKeyTraces = 0;
+
+static KeyTraceEntry *
+getKeyTraceEntry (unsigned int trace) {
+  if (trace) {
+    KeyTraceEntry *entry = &keyTraceRing[trace % KEY_TRACE_SIZE];
+    if (entry->identifier == trace) return entry;
+  }
+
+  return NULL;
+}
+
+static void
+setKeyTraceStage (KeyTraceEntry *entry, KeyTraceStage stage) {
+  unsigned char bit = 1 << stage;
+
+  if (!(entry->stages & bit)) {
+    getMonotonicTime(&entry->times[stage]);
+    entry->stages |= bit;
+
+    if (stage == KTR_EXECUTED) unwrittenKeyTraces += 1;
+    if (stage == KTR_WRITTEN) unwrittenKeyTraces -= 1;
+  }
+}
+
+static void
+exitKeyTraces (void) {
+  if (LOG_CATEGORY_FLAG(KEY_LATENCY)) logKeyTraces();
+}
+
+unsigned int
+startKeyTrace (void) {
+  if (LOG_CATEGORY_FLAG(KEY_LATENCY)) {
+    KeyTraceEntry *entry;
+
+    if (!keyTraceSequence) onProgramExit(exitKeyTraces, "key-traces");
+    if (!++keyTraceSequence) keyTraceSequence += 1;
+    entry = &keyTraceRing[keyTraceSequence % KEY_TRACE_SIZE];
+
+    if (entry->identifier) {
+      unsigned char executed = 1 << KTR_EXECUTED;
+      unsigned char written = 1 << KTR_WRITTEN;
+      if ((entry->stages & (executed | written)) == executed) unwrittenKeyTraces -= 1;
+    }
+
+    if (!(keyTraceSequence % KEY_TRACE_SIZE)) logKeyTraces();
+
+    memset(entry, 0, sizeof(*entry));
+    entry->identifier = keyTraceSequence;
+    setKeyTraceStage(entry, KTR_CAPTURED);
+    return entry->identifier;
+  }
+
+  return 0;
+}
+
+void
+resumeKeyTrace (unsigned int trace) {
+  currentKeyTrace = trace;
+}
+
+unsigned int
+getKeyTrace (void) {
+  return currentKeyTrace;
+}
+
+void
+markKeyTrace (KeyTraceStage stage) {
+  KeyTraceEntry *entry = getKeyTraceEntry(currentKeyTrace);
+
+  if (entry) setKeyTraceStage(entry, stage);
+}
+
+void
+markWrittenKeyTraces (void) {
+  if (unwrittenKeyTraces) {
+    KeyTraceEntry *entry = keyTraceRing;
+    const KeyTraceEntry *end = entry + KEY_TRACE_SIZE;
+
+    while (entry < end) {
+      if (entry->stages & (1 << KTR_EXECUTED)) setKeyTraceStage(entry, KTR_WRITTEN);
+      entry += 1;
+    }
+  }
+}
+
+static int
+sortLatencies (const void *element1, const void *element2) {
+  const long int *latency1 = element1;
+  const long int *latency2 = element2;
+
+  if (*latency1 < *latency2) return -1;
+  if (*latency1 > *latency2) return 1;
+  return 0;
+}
+
+static void
+logKeyLatencies (const char *label, KeyTraceStage from, KeyTraceStage to) {
+  long int latencies[KEY_TRACE_SIZE];
+  unsigned int count = 0;
+  unsigned char stages = (1 << from) | (1 << to);
+
+  {
+    const KeyTraceEntry *entry = keyTraceRing;
+    const KeyTraceEntry *end = entry + KEY_TRACE_SIZE;
+
+    while (entry < end) {
+      if ((entry->stages & stages) == stages) {
+        latencies[count++] = microsecondsBetween(&entry->times[from], &entry->times[to]);
+      }
+
+      entry += 1;
+    }
+  }
+
+  if (count) {
+    qsort(latencies, count, sizeof(*latencies), sortLatencies);
+
+    logMessage(LOG_CATEGORY(KEY_LATENCY),
+               "%s: %u events, 50%%=%ldus 90%%=%ldus 99%%=%ldus max=%ldus",
+               label, count,
+               latencies[(count * 50) / 100],
+               latencies[(count * 90) / 100],
+               latencies[(count * 99) / 100],
+               latencies[count - 1]);
+  }
+}
+
+void
+logKeyTraces (void) {
+  logKeyLatencies("captured to resolved", KTR_CAPTURED, KTR_RESOLVED);
+  logKeyLatencies("resolved to executed", KTR_RESOLVED, KTR_EXECUTED);
+  logKeyLatencies("executed to written", KTR_EXECUTED, KTR_WRITTEN);
+  logKeyLatencies("captured to written", KTR_CAPTURED, KTR_WRITTEN);
+}
@@ -0,0 +1,49 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2013 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://mielke.cc/brltty/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+
+#ifndef BRLTTY_INCLUDED_KEYTRACE
+#define BRLTTY_INCLUDED_KEYTRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef enum {
+  KTR_CAPTURED,
+  KTR_RESOLVED,
+  KTR_EXECUTED,
+  KTR_WRITTEN,
+
+  KTR_STAGE_COUNT /* must be last */
+} KeyTraceStage;
+
+extern unsigned int startKeyTrace (void);
+extern void resumeKeyTrace (unsigned int trace);
+extern unsigned int getKeyTrace (void);
+
+extern void markKeyTrace (KeyTraceStage stage);
+extern void markWrittenKeyTraces (void);
+
+extern void logKeyTraces (void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_KEYTRACE */
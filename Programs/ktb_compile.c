@@ -178,7 +178,8 @@ getKeyContext (KeyTableData *ktd, unsigned char context) {
       ctx->keyBindings.table = NULL;
       ctx->keyBindings.size = 0;
       ctx->keyBindings.count = 0;
-      ctx->keyBindings.sorted = NULL;
+      ctx->keyBindings.hash.table = NULL;
+      ctx->keyBindings.hash.mask = 0;
 
       ctx->hotkeys.table = NULL;
       ctx->hotkeys.count = 0;
@@ -1105,11 +1106,34 @@ compareKeyBindings (const KeyBinding *binding1, const KeyBinding *binding2) {
   return compareKeyCombinations(&binding1->combination, &binding2->combination);
 }
 
-static int
-sortKeyBindings (const void *element1, const void *element2) {
-  const KeyBinding *const *binding1 = element1;
-  const KeyBinding *const *binding2 = element2;
-  return compareKeyBindings(*binding1, *binding2);
+unsigned int
+hashKeyCombination (const KeyCombination *combination) {
+  unsigned int hash = 2166136261U;
+
+#define HASH_BYTE(byte) (hash = (hash ^ (byte)) * 16777619U)
+  if (combination->flags & KCF_IMMEDIATE_KEY) {
+    HASH_BYTE(combination->immediateKey.set);
+    HASH_BYTE(combination->immediateKey.key);
+  } else {
+    HASH_BYTE(KTB_KEY_ANY);
+    HASH_BYTE(KTB_KEY_ANY);
+  }
+
+  HASH_BYTE(combination->modifierCount);
+
+  {
+    unsigned int index;
+
+    for (index=0; index<combination->modifierCount; index+=1) {
+      const KeyValue *modifier = &combination->modifierKeys[index];
+
+      HASH_BYTE(modifier->set);
+      HASH_BYTE(modifier->key);
+    }
+  }
+#undef HASH_BYTE
+
+  return hash;
 }
 
 typedef struct {
@@ -1263,23 +1287,51 @@ prepareKeyBindings (KeyContext *ctx) {
   }
 
   if (ctx->keyBindings.count) {
-    if (!(ctx->keyBindings.sorted = malloc(ARRAY_SIZE(ctx->keyBindings.sorted, ctx->keyBindings.count)))) {
+    unsigned int size = 0X10;
+
+    while (size < (ctx->keyBindings.count * 2)) size <<= 1;
+
+    if (!(ctx->keyBindings.hash.table = calloc(size, sizeof(*ctx->keyBindings.hash.table)))) {
       logMallocError();
       return 0;
     }
 
+    ctx->keyBindings.hash.mask = size - 1;
+
     {
-      KeyBinding *source = ctx->keyBindings.table;
-      const KeyBinding **target = ctx->keyBindings.sorted;
-      unsigned int count = ctx->keyBindings.count;
+      const KeyBinding *binding = ctx->keyBindings.table;
+      const KeyBinding *end = binding + ctx->keyBindings.count;
 
-      while (count) {
-        *target++ = source++;
-        count -= 1;
+      while (binding < end) {
+        const KeyCombination *combination = &binding->combination;
+        unsigned int index = hashKeyCombination(combination) & ctx->keyBindings.hash.mask;
+        const KeyBinding *entry;
+
+        if (combination->flags & KCF_IMMEDIATE_KEY) {
+          if (combination->immediateKey.key == KTB_KEY_ANY) {
+            BITMASK_SET(ctx->keyBindings.anyKeySets, combination->immediateKey.set);
+          }
+        }
+
+        {
+          unsigned int modifier;
+
+          for (modifier=0; modifier<combination->modifierCount; modifier+=1) {
+            const KeyValue *key = &combination->modifierKeys[modifier];
+
+            if (key->key == KTB_KEY_ANY) BITMASK_SET(ctx->keyBindings.anyKeySets, key->set);
+          }
+        }
+
+        while ((entry = ctx->keyBindings.hash.table[index])) {
+          if (!compareKeyBindings(binding, entry)) break;
+          index = (index + 1) & ctx->keyBindings.hash.mask;
+        }
+
+        if (!entry) ctx->keyBindings.hash.table[index] = binding;
+        binding += 1;
       }
     }
-
-    qsort(ctx->keyBindings.sorted, ctx->keyBindings.count, sizeof(*ctx->keyBindings.sorted), sortKeyBindings);
   }
 
   return 1;
@@ -1433,7 +1485,7 @@ destroyKeyTable (KeyTable *table) {
     if (ctx->title) free(ctx->title);
 
     if (ctx->keyBindings.table) free(ctx->keyBindings.table);
-    if (ctx->keyBindings.sorted) free(ctx->keyBindings.sorted);
+    if (ctx->keyBindings.hash.table) free(ctx->keyBindings.hash.table);
 
     if (ctx->hotkeys.table) free(ctx->hotkeys.table);
     if (ctx->hotkeys.sorted) free(ctx->hotkeys.sorted);
@@ -20,6 +20,7 @@
 #define BRLTTY_INCLUDED_KTB_INTERNAL
 
 #include "async.h"
+#include "bitmask.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -87,7 +88,13 @@ typedef struct {
     KeyBinding *table;
     unsigned int size;
     unsigned int count;
-    const KeyBinding **sorted;
+
+    struct {
+      const KeyBinding **table;
+      unsigned int mask;
+    } hash;
+
+    BITMASK(anyKeySets, MAX_KEYS_PER_SET, char);
   } keyBindings;
 
   struct {
@@ -161,6 +168,7 @@ extern void removeKeyValue (KeyValue *values, unsigned int *count, unsigned int
 extern int deleteKeyValue (KeyValue *values, unsigned int *count, const KeyValue *value);
 
 extern int compareKeyBindings (const KeyBinding *binding1, const KeyBinding *binding2);
+extern unsigned int hashKeyCombination (const KeyCombination *combination);
 
 extern void resetLongPressData (KeyTable *table);
 
@@ -26,29 +26,49 @@
 #include "ktb.h"
 #include "ktb_internal.h"
 #include "ktb_inspect.h"
+#include "keytrace.h"
 #include "brl.h"
 
-static int
-sortModifierKeys (const void *element1, const void *element2) {
-  const KeyValue *modifier1 = element1;
-  const KeyValue *modifier2 = element2;
-  return compareKeyValues(modifier1, modifier2);
+static const KeyBinding *
+getKeyBinding (const KeyContext *ctx, const KeyBinding *target) {
+  unsigned int mask = ctx->keyBindings.hash.mask;
+  unsigned int index = hashKeyCombination(&target->combination) & mask;
+  const KeyBinding *binding;
+
+  while ((binding = ctx->keyBindings.hash.table[index])) {
+    if (!compareKeyBindings(target, binding)) return binding;
+    index = (index + 1) & mask;
+  }
+
+  return NULL;
 }
 
-static int
-searchKeyBinding (const void *target, const void *element) {
-  const KeyBinding *reference = target;
-  const KeyBinding *const *binding = element;
-  return compareKeyBindings(reference, *binding);
+static void
+sortModifierKeys (KeyValue *keys, unsigned int count) {
+  unsigned int index;
+
+  for (index=1; index<count; index+=1) {
+    KeyValue key = keys[index];
+    unsigned int position = index;
+
+    while (position && (compareKeyValues(&key, &keys[position-1]) < 0)) {
+      keys[position] = keys[position-1];
+      position -= 1;
+    }
+
+    keys[position] = key;
+  }
 }
 
 static const KeyBinding *
 findKeyBinding (KeyTable *table, unsigned char context, const KeyValue *immediate, int *isIncomplete) {
   const KeyContext *ctx = getKeyContext(table, context);
 
-  if (ctx && ctx->keyBindings.sorted &&
+  if (ctx && ctx->keyBindings.hash.table &&
       (table->pressedKeys.count <= MAX_MODIFIERS_PER_COMBINATION)) {
     KeyBinding target;
+    unsigned int wildcards = 0;
+
     memset(&target, 0, sizeof(target));
 
     if (immediate) {
@@ -57,36 +77,54 @@ findKeyBinding (KeyTable *table, unsigned char context, const KeyValue *immediat
     }
     target.combination.modifierCount = table->pressedKeys.count;
 
+    /* Only keys belonging to a set which is bound somewhere with a wildcard
+     * need to be tried as that wildcard. For most tables this means that
+     * only the combination of the keys themselves is looked up.
+     */
+    {
+      unsigned int index;
+      unsigned int bit;
+
+      for (index=0, bit=1; index<table->pressedKeys.count; index+=1, bit<<=1) {
+        if (BITMASK_TEST(ctx->keyBindings.anyKeySets, table->pressedKeys.table[index].set)) {
+          wildcards |= bit;
+        }
+      }
+    }
+
     while (1) {
-      unsigned int all = (1 << table->pressedKeys.count) - 1;
-      unsigned int bits;
+      unsigned int bits = 0;
 
-      for (bits=0; bits<=all; bits+=1) {
-        {
+      while (1) {
+        copyKeyValues(target.combination.modifierKeys, table->pressedKeys.table, table->pressedKeys.count);
+
+        if (bits) {
           unsigned int index;
           unsigned int bit;
 
           for (index=0, bit=1; index<table->pressedKeys.count; index+=1, bit<<=1) {
-            KeyValue *modifier = &target.combination.modifierKeys[index];
-
-            *modifier = table->pressedKeys.table[index];
-            if (bits & bit) modifier->key = KTB_KEY_ANY;
+            if (bits & bit) target.combination.modifierKeys[index].key = KTB_KEY_ANY;
           }
+
+          sortModifierKeys(target.combination.modifierKeys, table->pressedKeys.count);
         }
-        qsort(target.combination.modifierKeys, table->pressedKeys.count, sizeof(*target.combination.modifierKeys), sortModifierKeys);
 
         {
-          const KeyBinding *const *binding = bsearch(&target, ctx->keyBindings.sorted, ctx->keyBindings.count, sizeof(*ctx->keyBindings.sorted), searchKeyBinding);
+          const KeyBinding *binding = getKeyBinding(ctx, &target);
 
           if (binding) {
-            if ((*binding)->command != EOF) return *binding;
+            if (binding->command != EOF) return binding;
             *isIncomplete = 1;
           }
         }
+
+        if (bits == wildcards) break;
+        bits = ((bits | ~wildcards) + 1) & wildcards;
       }
 
       if (!(target.combination.flags & KCF_IMMEDIATE_KEY)) break;
       if (target.combination.immediateKey.key == KTB_KEY_ANY) break;
+      if (!BITMASK_TEST(ctx->keyBindings.anyKeySets, target.combination.immediateKey.set)) break;
       target.combination.immediateKey.key = KTB_KEY_ANY;
     }
   }
@@ -449,6 +487,8 @@ processKeyEvent (KeyTable *table, unsigned char context, unsigned char set, unsi
     }
   }
 
+  markKeyTrace(KTR_RESOLVED);
+
   if (table->logKeyEvents && *table->logKeyEvents) {
     char buffer[0X40];
 
@@ -30,12 +30,19 @@
 #include <pthread.h>
 #endif /* __MINGW32__ */
 
+#if defined(HAVE_POSIX_THREADS) && !defined(__MINGW32__)
+#define LOG_THREAD_SUPPORTED
+#include <pthread.h>
+#include <semaphore.h>
+#endif /* log thread support */
+
 #ifdef __ANDROID__
 #include <android/log.h>
 #endif /* __ANDROID__ */
 
 #include "log.h"
 #include "timing.h"
+#include "thread.h"
 
 const char *const logLevelNames[] = {
   "emergency", "alert", "critical", "error",
@@ -57,6 +64,11 @@ static const LogCategoryEntry logCategoryTable[LOG_CATEGORY_COUNT] = {
     .prefix = "generic input"
   },
 
+  [LOG_CATEGORY_INDEX(GENERIC_STATISTICS)] = {
+    .name = "statgio",
+    .prefix = "generic statistics"
+  },
+
   [LOG_CATEGORY_INDEX(INPUT_PACKETS)] = {
     .name = "inpkts",
     .prefix = "input packet"
@@ -77,6 +89,11 @@ static const LogCategoryEntry logCategoryTable[LOG_CATEGORY_COUNT] = {
     .prefix = "keyboard key"
   },
 
+  [LOG_CATEGORY_INDEX(KEY_LATENCY)] = {
+    .name = "keylat",
+    .prefix = "key latency"
+  },
+
   [LOG_CATEGORY_INDEX(CURSOR_TRACKING)] = {
     .name = "csrtrk",
     .prefix = "cursor tracking"
@@ -180,24 +197,21 @@ openLogFile (const char *path) {
 }
 
 static void
-writeLogRecord (const char *record) {
+writeLogRecord (const char *record, const TimeValue *time) {
   if (logFile) {
     {
-      TimeValue now;
       char buffer[0X20];
       size_t length;
       unsigned int milliseconds;
 
-      getCurrentTime(&now);
-      length = formatSeconds(buffer, sizeof(buffer), "%Y-%m-%d@%H:%M:%S", now.seconds);
-      milliseconds = now.nanoseconds / NSECS_PER_MSEC;
+      length = formatSeconds(buffer, sizeof(buffer), "%Y-%m-%d@%H:%M:%S", time->seconds);
+      milliseconds = time->nanoseconds / NSECS_PER_MSEC;
 
       fprintf(logFile, "%.*s.%03u ", (int)length, buffer, milliseconds);
     }
 
     fputs(record, logFile);
     fputc('\n', logFile);
-    fflush(logFile);
   }
 }
 
@@ -242,6 +256,290 @@ closeSystemLog (void) {
 #endif /* close system log */
 }
 
+static void
+deliverLogRecord (
+  const char *record, int level, int write, int print,
+  const char *prefix, const TimeValue *time
+) {
+  if (write) {
+    writeLogRecord(record, time);
+
+#if defined(WINDOWS)
+    if (windowsEventLog != INVALID_HANDLE_VALUE) {
+      const char *strings[] = {record};
+      ReportEvent(windowsEventLog, toWindowsEventType(level), 0, 0, NULL,
+                  ARRAY_COUNT(strings), 0, strings, NULL);
+    }
+
+#elif defined(__MSDOS__)
+
+#elif defined(__ANDROID__)
+    __android_log_write(toAndroidLogPriority(level), PACKAGE_NAME, record);
+
+#elif defined(HAVE_SYSLOG_H)
+    if (syslogOpened) syslog(level, "%s", record);
+#endif /* write system log */
+  }
+
+  if (print) {
+    FILE *stream = stderr;
+
+    if (prefix) {
+      fputs(prefix, stream);
+      fputs(": ", stream);
+    }
+
+    fputs(record, stream);
+    fputc('\n', stream);
+  }
+}
+
+#ifdef LOG_THREAD_SUPPORTED
+/* The log ring is a lock-free queue of formatted records which any thread may
+ * append to and which only the log thread removes from. A writer reserves
+ * space by advancing the head, fills in its entry, and then marks it ready.
+ * The log thread delivers ready entries in order, zeroes the space they used,
+ * and then advances the tail. A record which doesn't fit is dropped and
+ * counted rather than waited for.
+ */
+#define LOG_RING_SIZE 0X40000 /* must be a power of 2 */
+#define LOG_RING_ALIGN(size) (((size) + 7) & ~7)
+
+typedef enum {
+  LOG_ENTRY_EMPTY,
+  LOG_ENTRY_RECORD,
+  LOG_ENTRY_PADDING
+} LogEntryState;
+
+typedef struct {
+  volatile unsigned char state;
+  unsigned char level;
+  unsigned char write;
+  unsigned char print;
+  unsigned int size;
+  const char *prefix;
+  TimeValue time;
+} LogEntry;
+
+static struct {
+  unsigned char *buffer;
+  volatile unsigned int head;
+  volatile unsigned int tail;
+
+  volatile unsigned int dropped;
+  unsigned int reported;
+
+  pthread_t thread;
+  sem_t semaphore;
+  volatile int waiting;
+  volatile int stop;
+  volatile unsigned char active;
+} logRing;
+
+static void
+enqueueLogRecord (
+  const char *record, int level, int write, int print,
+  const TimeValue *time
+) {
+  size_t length = strlen(record) + 1;
+  unsigned int size = LOG_RING_ALIGN(sizeof(LogEntry) + length);
+
+  while (1) {
+    unsigned int head = logRing.head;
+    unsigned int used = head - logRing.tail;
+    unsigned int offset = head & (LOG_RING_SIZE - 1);
+    unsigned int contiguous = LOG_RING_SIZE - offset;
+    unsigned int skip = (size > contiguous)? contiguous: 0;
+
+    if ((used + skip + size) > LOG_RING_SIZE) {
+      __sync_fetch_and_add(&logRing.dropped, 1);
+      return;
+    }
+
+    if (__sync_bool_compare_and_swap(&logRing.head, head, head+skip+size)) {
+      LogEntry *entry;
+
+      if (skip) {
+        if (skip >= sizeof(*entry)) {
+          entry = (LogEntry *)&logRing.buffer[offset];
+          entry->size = skip;
+          __sync_synchronize();
+          entry->state = LOG_ENTRY_PADDING;
+        }
+
+        offset = 0;
+      }
+
+      entry = (LogEntry *)&logRing.buffer[offset];
+      entry->level = level;
+      entry->write = write;
+      entry->print = print;
+      entry->size = size;
+      entry->prefix = logPrefix;
+      entry->time = *time;
+      memcpy(entry+1, record, length);
+
+      __sync_synchronize();
+      entry->state = LOG_ENTRY_RECORD;
+      break;
+    }
+  }
+
+  __sync_synchronize();
+  if (logRing.waiting) {
+    if (__sync_bool_compare_and_swap(&logRing.waiting, 1, 0)) {
+      sem_post(&logRing.semaphore);
+    }
+  }
+}
+
+static int
+dequeueLogRecord (void) {
+  unsigned int tail = logRing.tail;
+  unsigned int offset = tail & (LOG_RING_SIZE - 1);
+  unsigned int contiguous = LOG_RING_SIZE - offset;
+  unsigned int size;
+
+  if (tail == logRing.head) return 0;
+
+  if (contiguous < sizeof(LogEntry)) {
+    size = contiguous;
+  } else {
+    LogEntry *entry = (LogEntry *)&logRing.buffer[offset];
+    LogEntryState state = entry->state;
+
+    if (state == LOG_ENTRY_EMPTY) return 0;
+    __sync_synchronize();
+    size = entry->size;
+
+    if (state == LOG_ENTRY_RECORD) {
+      deliverLogRecord((const char *)(entry+1), entry->level,
+                       entry->write, entry->print,
+                       entry->prefix, &entry->time);
+    }
+
+    memset(entry, 0, size);
+  }
+
+  __sync_synchronize();
+  logRing.tail = tail + size;
+  return 1;
+}
+
+static void
+reportDroppedLogRecords (void) {
+  unsigned int dropped = logRing.dropped;
+
+  if (dropped != logRing.reported) {
+    int level = LOG_WARNING;
+    int write = level <= systemLogLevel;
+    int print = level <= stderrLogLevel;
+
+    if (write || print) {
+      char record[0X40];
+      TimeValue now;
+
+      snprintf(record, sizeof(record), "log records dropped: %u",
+               dropped - logRing.reported);
+      getCurrentTime(&now);
+      deliverLogRecord(record, level, write, print, logPrefix, &now);
+    }
+
+    logRing.reported = dropped;
+  }
+}
+
+static void *
+runLogThread (void *argument) {
+  blockThreadSignals();
+
+  while (1) {
+    while (dequeueLogRecord());
+    reportDroppedLogRecords();
+
+    if (logFile) fflush(logFile);
+    fflush(stderr);
+
+    if (logRing.stop) break;
+    logRing.waiting = 1;
+    __sync_synchronize();
+
+    if (!logRing.stop && !dequeueLogRecord()) {
+      while (sem_wait(&logRing.semaphore) == -1) {
+        if (errno != EINTR) break;
+      }
+    }
+
+    logRing.waiting = 0;
+  }
+
+  return NULL;
+}
+
+static void
+stopLogThreadInChild (void) {
+  logRing.active = 0;
+}
+#endif /* LOG_THREAD_SUPPORTED */
+
+int
+startLogThread (void) {
+#ifdef LOG_THREAD_SUPPORTED
+  if (logRing.active) return 1;
+
+  if (!logRing.buffer) {
+    if (!onThreadFork(stopLogThreadInChild)) return 0;
+
+    if (!(logRing.buffer = malloc(LOG_RING_SIZE))) {
+      logMallocError();
+      return 0;
+    }
+  }
+
+  memset(logRing.buffer, 0, LOG_RING_SIZE);
+  logRing.head = logRing.tail = 0;
+  logRing.dropped = logRing.reported = 0;
+  logRing.waiting = 0;
+  logRing.stop = 0;
+
+  if (sem_init(&logRing.semaphore, 0, 0) != -1) {
+    int error = pthread_create(&logRing.thread, NULL, runLogThread, NULL);
+
+    if (!error) {
+      logRing.active = 1;
+      return 1;
+    }
+
+    errno = error;
+    logSystemError("pthread_create");
+    sem_destroy(&logRing.semaphore);
+  } else {
+    logSystemError("sem_init");
+  }
+#endif /* LOG_THREAD_SUPPORTED */
+
+  return 0;
+}
+
+void
+stopLogThread (void) {
+#ifdef LOG_THREAD_SUPPORTED
+  if (logRing.active) {
+    logRing.active = 0;
+    __sync_synchronize();
+
+    logRing.stop = 1;
+    sem_post(&logRing.semaphore);
+    pthread_join(logRing.thread, NULL);
+    sem_destroy(&logRing.semaphore);
+
+    /* The buffer is kept since a thread which saw the ring as active might
+     * still be writing into it. It's reused if the log thread is restarted.
+     */
+  }
+#endif /* LOG_THREAD_SUPPORTED */
+}
+
 void
 logData (int level, LogDataFormatter *formatLogData, const void *data) {
   const char *prefix = NULL;
@@ -266,6 +564,9 @@ logData (int level, LogDataFormatter *formatLogData, const void *data) {
     if (write || print) {
       int oldErrno = errno;
       char record[0X1000];
+      TimeValue now;
+
+      getCurrentTime(&now);
 
       STR_BEGIN(record, sizeof(record));
       if (prefix) STR_PRINTF("%s: ", prefix);
@@ -275,37 +576,16 @@ logData (int level, LogDataFormatter *formatLogData, const void *data) {
       }
       STR_END
 
-      if (write) {
-        writeLogRecord(record);
-
-#if defined(WINDOWS)
-        if (windowsEventLog != INVALID_HANDLE_VALUE) {
-          const char *strings[] = {record};
-          ReportEvent(windowsEventLog, toWindowsEventType(level), 0, 0, NULL,
-                      ARRAY_COUNT(strings), 0, strings, NULL);
-        }
-
-#elif defined(__MSDOS__)
-
-#elif defined(__ANDROID__)
-        __android_log_write(toAndroidLogPriority(level), PACKAGE_NAME, record);
-
-#elif defined(HAVE_SYSLOG_H)
-        if (syslogOpened) syslog(level, "%s", record);
-#endif /* write system log */
-      }
-
-      if (print) {
-        FILE *stream = stderr;
-
-        if (logPrefix) {
-          fputs(logPrefix, stream);
-          fputs(": ", stream);
-        }
+#ifdef LOG_THREAD_SUPPORTED
+      if (logRing.active) {
+        enqueueLogRecord(record, level, write, print, &now);
+      } else
+#endif /* LOG_THREAD_SUPPORTED */
+      {
+        deliverLogRecord(record, level, write, print, logPrefix, &now);
 
-        fputs(record, stream);
-        fputc('\n', stream);
-        fflush(stream);
+        if (write && logFile) fflush(logFile);
+        if (print) fflush(stderr);
       }
 
       errno = oldErrno;
@@ -56,12 +56,14 @@ extern const unsigned int logLevelCount;
 
 typedef enum {
   LOG_CATEGORY_INDEX(GENERIC_INPUT),
+  LOG_CATEGORY_INDEX(GENERIC_STATISTICS),
 
   LOG_CATEGORY_INDEX(INPUT_PACKETS),
   LOG_CATEGORY_INDEX(OUTPUT_PACKETS),
 
   LOG_CATEGORY_INDEX(BRAILLE_KEY_EVENTS),
   LOG_CATEGORY_INDEX(KEYBOARD_KEY_EVENTS),
+  LOG_CATEGORY_INDEX(KEY_LATENCY),
 
   LOG_CATEGORY_INDEX(CURSOR_TRACKING),
   LOG_CATEGORY_INDEX(CURSOR_ROUTING),
@@ -84,6 +86,9 @@ extern void closeSystemLog (void);
 
 extern const char *setLogPrefix (const char *newPrefix);
 
+extern int startLogThread (void);
+extern void stopLogThread (void);
+
 typedef size_t LogDataFormatter (char *buffer, size_t size, const void *data);
 extern void logData (int level, LogDataFormatter *formatLogData, const void *data);
 
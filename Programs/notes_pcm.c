@@ -34,10 +34,32 @@ struct NoteDeviceStruct {
   int sampleRate;
   int channelCount;
   PcmAmplitudeFormat amplitudeFormat;
+  size_t frameSize;
   unsigned char *blockAddress;
   size_t blockUsed;
+  unsigned char *silenceFrame;
+
+  struct {
+    unsigned char note;
+    unsigned char volume;
+    unsigned int frameCount;
+    unsigned char *frames;
+  } wave;
 };
 
+static void
+makeFrame (NoteDevice *device, int amplitude, unsigned char *frame) {
+  size_t length = makePcmSample(device->amplitudeFormat, amplitude, frame, device->frameSize);
+
+  /* replicate the first channel's sample into the others */
+  while (length < device->frameSize) {
+    size_t count = device->frameSize - length;
+    if (count > length) count = length;
+    memcpy(&frame[length], frame, count);
+    length += count;
+  }
+}
+
 static NoteDevice *
 pcmConstruct (int errorLevel) {
   NoteDevice *device;
@@ -48,14 +70,36 @@ pcmConstruct (int errorLevel) {
       device->sampleRate = getPcmSampleRate(device->pcm);
       device->channelCount = getPcmChannelCount(device->pcm);
       device->amplitudeFormat = getPcmAmplitudeFormat(device->pcm);
+      device->frameSize = getPcmSampleLength(device->amplitudeFormat) * device->channelCount;
       device->blockUsed = 0;
 
-      if ((device->blockAddress = malloc(device->blockSize))) {
-        logMessage(LOG_DEBUG, "PCM enabled: blk=%d rate=%d chan=%d fmt=%d",
-                   device->blockSize, device->sampleRate, device->channelCount, device->amplitudeFormat);
-        return device;
+      device->wave.note = 0;
+      device->wave.volume = 0;
+      device->wave.frameCount = 0;
+      device->wave.frames = NULL;
+
+      if (device->frameSize) {
+        /* only whole frames are handed to the device */
+        device->blockSize -= device->blockSize % device->frameSize;
+        if (!device->blockSize) device->blockSize = device->frameSize;
+
+        if ((device->blockAddress = malloc(device->blockSize))) {
+          if ((device->silenceFrame = malloc(device->frameSize))) {
+            makeFrame(device, 0, device->silenceFrame);
+
+            logMessage(LOG_DEBUG, "PCM enabled: blk=%d rate=%d chan=%d fmt=%d",
+                       device->blockSize, device->sampleRate, device->channelCount, device->amplitudeFormat);
+            return device;
+          } else {
+            logMallocError();
+          }
+
+          free(device->blockAddress);
+        } else {
+          logMallocError();
+        }
       } else {
-        logMallocError();
+        logMessage(LOG_DEBUG, "unsupported PCM amplitude format: %d", device->amplitudeFormat);
       }
 
       closePcmDevice(device->pcm);
@@ -78,38 +122,95 @@ flushBytes (NoteDevice *device) {
 }
 
 static int
-writeBytes (NoteDevice *device, const unsigned char *address, size_t length) {
-  while (length > 0) {
-    size_t count = device->blockSize - device->blockUsed;
-    if (length < count) count = length;
-    memcpy(&device->blockAddress[device->blockUsed], address, count);
-    address += count;
-    length -= count;
+makeWave (NoteDevice *device, unsigned char note) {
+  unsigned char volume = prefs.pcmVolume;
 
-    if ((device->blockUsed += count) == device->blockSize)
-      if (!flushBytes(device))
+  if ((note != device->wave.note) || (volume != device->wave.volume)) {
+    NOTE_FREQUENCY_TYPE frequency = GET_NOTE_FREQUENCY(note);
+    unsigned int frameCount = (unsigned int)(device->sampleRate / frequency) + 1;
+
+    /* A triangle waveform sounds nice, is lightweight, and avoids
+     * relying too much on floating-point performance and/or on
+     * expensive math functions like sin(). Considerations like
+     * these are especially important on PDAs without any FPU.
+     */ 
+
+    int32_t positiveShiftsPerQuarterWave = INT32_MAX / 8;
+    int32_t negativeShiftsPerQuarterWave = -positiveShiftsPerQuarterWave;
+
+    int32_t positiveShiftsPerHalfWave = 2 * positiveShiftsPerQuarterWave;
+    int32_t negativeSiftsPerHalfWave = -positiveShiftsPerHalfWave;
+
+    int32_t positiveShiftsPerFullWave = 2 * positiveShiftsPerHalfWave;
+
+    int32_t maximumAmplitude = INT16_MAX * volume / 100;
+    int32_t amplitudeGranularity = maximumAmplitude? (positiveShiftsPerQuarterWave / maximumAmplitude): 0;
+
+    if (frameCount > device->wave.frameCount) {
+      unsigned char *frames = realloc(device->wave.frames, frameCount * device->frameSize);
+
+      if (!frames) {
+        logMallocError();
         return 0;
+      }
+
+      device->wave.frames = frames;
+    }
+
+    /* one period of the wave, formatted for the device, is played from for the whole note */
+    {
+      unsigned char *frame = device->wave.frames;
+      unsigned int index;
+
+      for (index=0; index<frameCount; index+=1) {
+        int32_t currentShift = (int64_t)positiveShiftsPerFullWave * index / frameCount;
+        int32_t normalizedAmplitude = positiveShiftsPerHalfWave - currentShift;
+
+        if (normalizedAmplitude > positiveShiftsPerQuarterWave) {
+          normalizedAmplitude = positiveShiftsPerHalfWave - normalizedAmplitude;
+        } else if (normalizedAmplitude < negativeShiftsPerQuarterWave) {
+          normalizedAmplitude = negativeSiftsPerHalfWave - normalizedAmplitude;
+        }
+
+        makeFrame(device, (amplitudeGranularity? (normalizedAmplitude / amplitudeGranularity): 0), frame);
+        frame += device->frameSize;
+      }
+    }
+
+    device->wave.note = note;
+    device->wave.volume = volume;
+    device->wave.frameCount = frameCount;
   }
 
   return 1;
 }
 
 static int
-writeSample (NoteDevice *device, int amplitude) {
-  PcmAmplitudeFormat format = device->amplitudeFormat;
-  size_t length = getPcmSampleLength(format);;
+writeSilence (NoteDevice *device, long int frameCount) {
+  while (frameCount > 0) {
+    unsigned char *block = &device->blockAddress[device->blockUsed];
+    size_t length = frameCount * device->frameSize;
+    size_t count = device->blockSize - device->blockUsed;
 
-  if (length) {
-    unsigned char buffer[length];
-    length = makePcmSample(format, amplitude, buffer, sizeof(buffer));
+    if (count > length) count = length;
+    frameCount -= count / device->frameSize;
+    memcpy(block, device->silenceFrame, device->frameSize);
 
+    /* widen the copy by doubling what has already been filled in */
     {
-      int channel;
+      size_t done = device->frameSize;
 
-      for (channel=0; channel<device->channelCount; channel+=1) {
-        if (!writeBytes(device, buffer, length)) return 0;
+      while (done < count) {
+        size_t size = count - done;
+        if (size > done) size = done;
+        memcpy(&block[done], block, size);
+        done += size;
       }
     }
+
+    if ((device->blockUsed += count) == device->blockSize)
+      if (!flushBytes(device))
+        return 0;
   }
 
   return 1;
@@ -119,62 +220,40 @@ static int
 pcmPlay (NoteDevice *device, unsigned char note, unsigned int duration) {
   long int sampleCount = device->sampleRate * duration / 1000;
 
-  if (note) {
-    /* A triangle waveform sounds nice, is lightweight, and avoids
-     * relying too much on floating-point performance and/or on
-     * expensive math functions like sin(). Considerations like
-     * these are especially important on PDAs without any FPU.
-     */ 
-
-    int32_t positiveShiftsPerQuarterWave = INT32_MAX / 8;
-    int32_t negativeShiftsPerQuarterWave = -positiveShiftsPerQuarterWave;
+  logMessage(LOG_DEBUG, "tone: msec=%d smct=%lu note=%d",
+             duration, sampleCount, note);
 
-    int32_t positiveShiftsPerHalfWave = 2 * positiveShiftsPerQuarterWave;
-    int32_t negativeSiftsPerHalfWave = -positiveShiftsPerHalfWave;
+  if (!note) return writeSilence(device, sampleCount);
+  if (!makeWave(device, note)) return 0;
 
-    int32_t positiveShiftsPerFullWave = 2 * positiveShiftsPerHalfWave;
-    int32_t currentShift = 0;
+  {
+    const unsigned char *frames = device->wave.frames;
+    size_t frameSize = device->frameSize;
 
-    int32_t shiftsPerSample = (NOTE_FREQUENCY_TYPE)positiveShiftsPerFullWave 
-                            / (NOTE_FREQUENCY_TYPE)device->sampleRate
-                            * GET_NOTE_FREQUENCY(note);
-
-    int32_t maximumAmplitude = INT16_MAX * prefs.pcmVolume / 100;
-    int32_t amplitudeGranularity = positiveShiftsPerQuarterWave / maximumAmplitude;
-
-    logMessage(LOG_DEBUG, "tone: msec=%d smct=%lu note=%d",
-               duration, sampleCount, note);
+    /* the position within the period is a 16.16 fixed-point frame index */
+    uint64_t period = (uint64_t)device->wave.frameCount << 16;
+    uint64_t step = ((uint64_t)device->wave.frameCount << 16) * GET_NOTE_FREQUENCY(note) / device->sampleRate;
+    uint64_t position = 0;
 
     while (sampleCount > 0) {
-      do {
-        {
-          int32_t normalizedAmplitude = positiveShiftsPerHalfWave - currentShift;
-
-          if (normalizedAmplitude > positiveShiftsPerQuarterWave) {
-            normalizedAmplitude = positiveShiftsPerHalfWave - normalizedAmplitude;
-          } else if (normalizedAmplitude < negativeShiftsPerQuarterWave) {
-            normalizedAmplitude = negativeSiftsPerHalfWave - normalizedAmplitude;
-          }
+      unsigned char *block = &device->blockAddress[device->blockUsed];
+      long int count = (device->blockSize - device->blockUsed) / frameSize;
 
-          {
-            int32_t actualAmplitude = normalizedAmplitude / amplitudeGranularity;
-            if (!writeSample(device, actualAmplitude)) return 0;
-            sampleCount -= 1;
-          }
-        }
-      } while ((currentShift += shiftsPerSample) < positiveShiftsPerFullWave);
+      if (count > sampleCount) count = sampleCount;
+      sampleCount -= count;
+      device->blockUsed += count * frameSize;
 
-      do {
-        currentShift -= positiveShiftsPerFullWave;
-      } while (currentShift >= positiveShiftsPerFullWave);
-    }
-  } else {
-    logMessage(LOG_DEBUG, "tone: msec=%d smct=%lu note=%d",
-               duration, sampleCount, note);
+      while (count > 0) {
+        memcpy(block, &frames[(position >> 16) * frameSize], frameSize);
+        block += frameSize;
+        count -= 1;
 
-    while (sampleCount > 0) {
-      if (!writeSample(device, 0)) return 0;
-      --sampleCount;
+        if ((position += step) >= period) position -= period;
+      }
+
+      if (device->blockUsed == device->blockSize)
+        if (!flushBytes(device))
+          return 0;
     }
   }
 
@@ -183,9 +262,11 @@ pcmPlay (NoteDevice *device, unsigned char note, unsigned int duration) {
 
 static int
 flushBlock (NoteDevice *device) {
-  while (device->blockUsed)
-    if (!writeSample(device, 0))
+  if (device->blockUsed) {
+    if (!writeSilence(device, (device->blockSize - device->blockUsed) / device->frameSize)) {
       return 0;
+    }
+  }
 
   return 1;
 }
@@ -198,6 +279,8 @@ pcmFlush (NoteDevice *device) {
 static void
 pcmDestruct (NoteDevice *device) {
   flushBlock(device);
+  if (device->wave.frames) free(device->wave.frames);
+  free(device->silenceFrame);
   free(device->blockAddress);
   closePcmDevice(device->pcm);
   free(device);
@@ -21,6 +21,10 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif /* HAVE_SIGNAL_H */
+
 #include "log.h"
 #include "parse.h"
 #include "device.h"
@@ -157,6 +161,46 @@ serialSetParity (SerialDevice *serial, SerialParity parity) {
 }
 
 #ifdef HAVE_POSIX_THREADS
+#if defined(HAVE_SIGACTION) && defined(SIGRTMIN)
+/* Waiting for a line change (TIOCMIWAIT) can block indefinitely, and
+ * isn't a cancellation point, so the thread is woken with a signal when
+ * it's to be stopped. A real-time signal is used since nothing else uses
+ * one, and its handler is installed without SA_RESTART so that the wait
+ * returns (with EINTR) rather than being restarted.
+ */
+#define SERIAL_FLOW_CONTROL_WAKE_SIGNAL SIGRTMIN
+#define SERIAL_FLOW_CONTROL_STOP_TIMEOUT 1000
+
+static void
+handleFlowControlWakeSignal (int signalNumber) {
+}
+
+static int
+serialPrepareFlowControlWakeSignal (void) {
+  struct sigaction action;
+
+  if (sigaction(SERIAL_FLOW_CONTROL_WAKE_SIGNAL, NULL, &action) == -1) {
+    logSystemError("sigaction");
+    return 0;
+  }
+
+  if ((action.sa_handler == handleFlowControlWakeSignal) && !(action.sa_flags & SA_RESTART)) return 1;
+
+  if ((action.sa_handler != SIG_DFL) && (action.sa_handler != handleFlowControlWakeSignal)) {
+    logMessage(LOG_WARNING, "flow control wake signal already in use: %d", SERIAL_FLOW_CONTROL_WAKE_SIGNAL);
+    return 0;
+  }
+
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = handleFlowControlWakeSignal;
+
+  if (sigaction(SERIAL_FLOW_CONTROL_WAKE_SIGNAL, &action, NULL) != -1) return 1;
+  logSystemError("sigaction");
+  return 0;
+}
+#endif /* defined(HAVE_SIGACTION) && defined(SIGRTMIN) */
+
 static void *
 flowControlProc_InputCts (void *arg) {
   SerialDevice *serial = arg;
@@ -164,9 +208,10 @@ flowControlProc_InputCts (void *arg) {
 
   while (!serial->flowControlStop) {
     serialSetLineRTS(serial, up);
-    serialWaitLineCTS(serial, (up = !up), 0);
+    if (!serialWaitLineCTS(serial, (up = !up), 0)) break;
   }
 
+  serial->flowControlDone = 1;
   return NULL;
 }
 
@@ -174,13 +219,15 @@ static int
 serialStartFlowControlThread (SerialDevice *serial) {
   if (!serial->flowControlRunning && serial->currentFlowControlProc) {
     pthread_t thread;
-    pthread_attr_t attributes;
 
-    pthread_attr_init(&attributes);
-    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+#ifdef SERIAL_FLOW_CONTROL_WAKE_SIGNAL
+    if (!serialPrepareFlowControlWakeSignal()) return 0;
+#endif /* SERIAL_FLOW_CONTROL_WAKE_SIGNAL */
 
     serial->flowControlStop = 0;
-    if (pthread_create(&thread, &attributes, serial->currentFlowControlProc, serial)) {
+    serial->flowControlDone = 0;
+
+    if (pthread_create(&thread, NULL, serial->currentFlowControlProc, serial)) {
       logSystemError("pthread_create");
       return 0;
     }
@@ -196,6 +243,31 @@ static void
 serialStopFlowControlThread (SerialDevice *serial) {
   if (serial->flowControlRunning) {
     serial->flowControlStop = 1;
+
+#ifdef SERIAL_FLOW_CONTROL_WAKE_SIGNAL
+    if (serialPrepareFlowControlWakeSignal()) {
+      TimePeriod period;
+      startTimePeriod(&period, SERIAL_FLOW_CONTROL_STOP_TIMEOUT);
+
+      /* the signal is missed if it arrives just before the wait begins */
+      while (!serial->flowControlDone) {
+        if (afterTimePeriod(&period, NULL)) break;
+        pthread_kill(serial->flowControlThread, SERIAL_FLOW_CONTROL_WAKE_SIGNAL);
+        approximateDelay(1);
+      }
+    }
+
+    if (!serial->flowControlDone) {
+      logMessage(LOG_WARNING, "flow control thread not stopping");
+      pthread_detach(serial->flowControlThread);
+    } else {
+      pthread_join(serial->flowControlThread, NULL);
+    }
+#else /* SERIAL_FLOW_CONTROL_WAKE_SIGNAL */
+    pthread_cancel(serial->flowControlThread);
+    pthread_join(serial->flowControlThread, NULL);
+#endif /* SERIAL_FLOW_CONTROL_WAKE_SIGNAL */
+
     serial->flowControlRunning = 0;
   }
 }
@@ -335,6 +407,26 @@ serialAwaitInput (SerialDevice *serial, int timeout) {
   return 1;
 }
 
+static void
+serialStopInputMonitor (SerialDevice *serial) {
+  if (serial->inputMonitor) {
+    asyncCancelRequest(serial->inputMonitor);
+    serial->inputMonitor = NULL;
+  }
+}
+
+int
+serialMonitorInput (SerialDevice *serial, AsyncMonitorCallback callback, void *data) {
+  serialStopInputMonitor(serial);
+  if (!callback) return 1;
+
+  if (!serialFlushAttributes(serial)) return 0;
+  if (serialRegisterInputMonitor(serial, callback, data)) return 1;
+
+  serial->inputMonitor = NULL;
+  return 0;
+}
+
 ssize_t
 serialReadData (
   SerialDevice *serial,
@@ -360,7 +452,7 @@ serialReadChunk (
   byte += *offset;
 
   while (byte < end) {
-    ssize_t result = serialGetData(serial, byte, 1, timeout, subsequentTimeout);
+    ssize_t result = serialGetData(serial, byte, end-byte, timeout, subsequentTimeout);
 
     if (!result) {
       result = -1;
@@ -372,8 +464,8 @@ serialReadChunk (
       return 0;
     }
 
-    byte += 1;
-    *offset += 1;
+    byte += result;
+    *offset += result;
     timeout = subsequentTimeout;
   }
 
@@ -530,6 +622,7 @@ serialOpenDevice (const char *path) {
     if ((device = getDevicePath(path))) {
       serial->fileDescriptor = -1;
       serial->stream = NULL;
+      serial->inputMonitor = NULL;
 
       if (serialConnectDevice(serial, device)) {
         free(device);
@@ -549,6 +642,8 @@ serialOpenDevice (const char *path) {
 
 void
 serialCloseDevice (SerialDevice *serial) {
+  serialStopInputMonitor(serial);
+
 #ifdef HAVE_POSIX_THREADS
   serialStopFlowControlThread(serial);
 #endif /* HAVE_POSIX_THREADS */
@@ -173,6 +173,12 @@ serialPollInput (SerialDevice *serial, int timeout) {
   return 1;
 }
 
+int
+serialRegisterInputMonitor (SerialDevice *serial, AsyncMonitorCallback callback, void *data) {
+  logUnsupportedFunction();
+  return 0;
+}
+
 int
 serialDrainOutput (SerialDevice *serial) {
   return 1;
@@ -56,8 +56,10 @@ struct SerialDeviceStruct {
   pthread_t flowControlThread;
   unsigned flowControlRunning:1;
   unsigned flowControlStop:1;
+  volatile unsigned char flowControlDone;
 #endif /* HAVE_POSIX_THREADS */
 
+  AsyncHandle inputMonitor;
   SerialPackageFields package;
 };
 
@@ -91,6 +93,7 @@ extern int serialCancelInput (SerialDevice *serial);
 extern int serialCancelOutput (SerialDevice *serial);
 
 extern int serialPollInput (SerialDevice *serial, int timeout);
+extern int serialRegisterInputMonitor (SerialDevice *serial, AsyncMonitorCallback callback, void *data);
 extern int serialDrainOutput (SerialDevice *serial);
 
 extern ssize_t serialGetData (
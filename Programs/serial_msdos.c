@@ -220,6 +220,11 @@ serialPollInput (SerialDevice *serial, int timeout) {
   return awaitFileInput(serial->fileDescriptor, timeout);
 }
 
+int
+serialRegisterInputMonitor (SerialDevice *serial, AsyncMonitorCallback callback, void *data) {
+  return asyncMonitorFileInput(&serial->inputMonitor, serial->fileDescriptor, callback, data);
+}
+
 int
 serialDrainOutput (SerialDevice *serial) {
   return 1;
@@ -20,6 +20,7 @@
 
 #include <errno.h>
 
+#include "log.h"
 #include "serial_none.h"
 #include "serial_internal.h"
 
@@ -103,6 +104,12 @@ serialPollInput (SerialDevice *serial, int timeout) {
   return 0;
 }
 
+int
+serialRegisterInputMonitor (SerialDevice *serial, AsyncMonitorCallback callback, void *data) {
+  logUnsupportedFunction();
+  return 0;
+}
+
 int
 serialDrainOutput (SerialDevice *serial) {
   return 1;
@@ -394,6 +394,11 @@ serialPollInput (SerialDevice *serial, int timeout) {
   return awaitFileInput(serial->fileDescriptor, timeout);
 }
 
+int
+serialRegisterInputMonitor (SerialDevice *serial, AsyncMonitorCallback callback, void *data) {
+  return asyncMonitorFileInput(&serial->inputMonitor, serial->fileDescriptor, callback, data);
+}
+
 int
 serialDrainOutput (SerialDevice *serial) {
 #ifdef HAVE_TCDRAIN
@@ -467,23 +472,49 @@ int
 serialMonitorWaitLines (SerialDevice *serial) {
 #ifdef TIOCMIWAIT
   if (ioctl(serial->fileDescriptor, TIOCMIWAIT, serial->waitLines) != -1) return 1;
-  logSystemError("TIOCMIWAIT");
+  if (errno != EINTR) logSystemError("TIOCMIWAIT");
 #else /* TIOCMIWAIT */
   SerialLines old = serial->linesState & serial->waitLines;
 
   while (serialGetLines(serial)) {
     if ((serial->linesState & serial->waitLines) != old) return 1;
+
+#ifdef HAVE_POSIX_THREADS
+    if (serial->flowControlStop) break;
+#endif /* HAVE_POSIX_THREADS */
   }
 #endif /* TIOCMIWAIT */
 
   return 0;
 }
 
+static void
+serialSetLowLatency (SerialDevice *serial) {
+#if defined(TIOCGSERIAL) && defined(TIOCSSERIAL) && defined(ASYNC_LOW_LATENCY)
+  struct serial_struct info;
+
+  if (ioctl(serial->fileDescriptor, TIOCGSERIAL, &info) != -1) {
+    if (!(info.flags & ASYNC_LOW_LATENCY)) {
+      info.flags |= ASYNC_LOW_LATENCY;
+
+      if (ioctl(serial->fileDescriptor, TIOCSSERIAL, &info) != -1) {
+        logMessage(LOG_DEBUG, "serial low latency enabled");
+      } else {
+        logMessage(LOG_DEBUG, "cannot enable serial low latency: %s", strerror(errno));
+      }
+    }
+  } else {
+    logMessage(LOG_DEBUG, "cannot get serial information: %s", strerror(errno));
+  }
+#endif /* ASYNC_LOW_LATENCY */
+}
+
 int
 serialConnectDevice (SerialDevice *serial, const char *device) {
   if ((serial->fileDescriptor = open(device, O_RDWR|O_NOCTTY|O_NONBLOCK)) != -1) {
     if (isatty(serial->fileDescriptor)) {
       if (serialPrepareDevice(serial)) {
+        serialSetLowLatency(serial);
         logMessage(LOG_DEBUG, "serial device opened: %s: fd=%d",
                    device, serial->fileDescriptor);
         return 1;
@@ -26,6 +26,10 @@
 #include <sys/modem.h>
 #endif /* HAVE_SYS_MODEM_H */
 
+#ifdef HAVE_LINUX_SERIAL_H
+#include <linux/serial.h>
+#endif /* HAVE_LINUX_SERIAL_H */
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -295,6 +295,12 @@ serialPollInput (SerialDevice *serial, int timeout) {
   return 0;
 }
 
+int
+serialRegisterInputMonitor (SerialDevice *serial, AsyncMonitorCallback callback, void *data) {
+  logUnsupportedFunction();
+  return 0;
+}
+
 int
 serialDrainOutput (SerialDevice *serial) {
   if (FlushFileBuffers(serial->package.fileHandle)) return 1;
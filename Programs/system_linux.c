@@ -277,6 +277,23 @@ writeInputEvent (uint16_t type, uint16_t code, int32_t value) {
   return 0;
 }
 
+int
+writeInputEvents (const struct input_event *events, size_t count) {
+#ifdef HAVE_LINUX_INPUT_H
+  int device = getUinputDevice();
+
+  if (device != -1) {
+    if (write(device, events, (count * sizeof(*events))) != -1) {
+      return 1;
+    } else {
+      logSystemError("write(struct input_event)");
+    }
+  }
+#endif /* HAVE_LINUX_INPUT_H */
+
+  return 0;
+}
+
 #ifdef HAVE_LINUX_INPUT_H
 static BITMASK(pressedKeys, KEY_MAX+1, char);
 #endif /* HAVE_LINUX_INPUT_H */
@@ -284,15 +301,27 @@ static BITMASK(pressedKeys, KEY_MAX+1, char);
 int
 writeKeyEvent (int key, int press) {
 #ifdef HAVE_LINUX_INPUT_H
-  if (writeInputEvent(EV_KEY, key, press)) {
+  struct input_event events[2];
+
+  memset(events, 0, sizeof(events));
+  gettimeofday(&events[0].time, NULL);
+  events[1].time = events[0].time;
+
+  events[0].type = EV_KEY;
+  events[0].code = key;
+  events[0].value = press;
+
+  events[1].type = EV_SYN;
+  events[1].code = SYN_REPORT;
+  events[1].value = 0;
+
+  if (writeInputEvents(events, ARRAY_COUNT(events))) {
     if (press) {
       BITMASK_SET(pressedKeys, key);
     } else {
       BITMASK_CLEAR(pressedKeys, key);
     }
 
-    writeInputEvent(EV_SYN, SYN_REPORT, 0);
-
     return 1;
   }
 #endif /* HAVE_LINUX_INPUT_H */
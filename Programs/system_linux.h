@@ -31,6 +31,9 @@ extern int getUinputDevice (void);
 extern int hasInputEvent (int device, uint16_t type, uint16_t code, uint16_t max);
 extern int writeInputEvent (uint16_t type, uint16_t code, int32_t value);
 
+struct input_event;
+extern int writeInputEvents (const struct input_event *events, size_t count);
+
 extern int writeKeyEvent (int key, int press);
 extern void releaseAllKeys (void);
 
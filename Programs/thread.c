@@ -0,0 +1,57 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2013 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://mielke.cc/brltty/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#if defined(HAVE_POSIX_THREADS) && !defined(__MINGW32__)
+#define THREAD_SUPPORTED
+#include <pthread.h>
+
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif /* HAVE_SIGNAL_H */
+#endif /* thread support */
+
+#include "log.h"
+#include "thread.h"
+
+int
+onThreadFork (ThreadForkHandler *handler) {
+#ifdef THREAD_SUPPORTED
+  /* a forked process (e.g. cursor routing) doesn't inherit the thread,
+   * so the handler, run in the child, must mark it as not running
+   */
+  if (pthread_atfork(NULL, NULL, handler) != 0) {
+    logMessage(LOG_WARNING, "pthread_atfork failed");
+    return 0;
+  }
+#endif /* THREAD_SUPPORTED */
+
+  return 1;
+}
+
+void
+blockThreadSignals (void) {
+#if defined(THREAD_SUPPORTED) && defined(HAVE_SIGNAL_H)
+  /* signals are for the main thread */
+  sigset_t signals;
+
+  sigfillset(&signals);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+#endif /* defined(THREAD_SUPPORTED) && defined(HAVE_SIGNAL_H) */
+}
@@ -205,6 +205,18 @@ millisecondsBetween (const TimeValue *from, const TimeValue *to) {
        + (elapsed.nanoseconds / NSECS_PER_MSEC);
 }
 
+long int
+microsecondsBetween (const TimeValue *from, const TimeValue *to) {
+  TimeValue elapsed = {
+    .seconds = to->seconds - from->seconds,
+    .nanoseconds = to->nanoseconds - from->nanoseconds
+  };
+
+  normalizeTimeValue(&elapsed);
+  return (elapsed.seconds * USECS_PER_SEC)
+       + (elapsed.nanoseconds / NSECS_PER_USEC);
+}
+
 void
 getMonotonicTime (TimeValue *now) {
 #if defined(GRUB_RUNTIME)
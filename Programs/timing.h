@@ -59,6 +59,7 @@ extern void getRelativeTime (TimeValue *time, int milliseconds);
 
 extern int compareTimeValues (const TimeValue *first, const TimeValue *second);
 extern long int millisecondsBetween (const TimeValue *from, const TimeValue *to);
+extern long int microsecondsBetween (const TimeValue *from, const TimeValue *to);
 
 extern void getMonotonicTime (TimeValue *now);
 extern long int getMonotonicElapsed (const TimeValue *start);
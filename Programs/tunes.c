@@ -19,9 +19,17 @@
 #include "prologue.h"
 
 #include <string.h>
+#include <errno.h>
+
+#if defined(HAVE_POSIX_THREADS) && !defined(__MINGW32__)
+#define TUNE_THREAD_SUPPORTED
+#include <pthread.h>
+#endif /* defined(HAVE_POSIX_THREADS) && !defined(__MINGW32__) */
 
 #include "log.h"
+#include "timing.h"
 #include "async.h"
+#include "thread.h"
 #include "prefs.h"
 #include "tunes.h"
 #include "notes.h"
@@ -318,22 +326,229 @@ static NoteDevice *noteDevice = NULL;
 static AsyncHandle tunesCloseTimer = NULL;
 static int openErrorLevel = LOG_ERR;
 
+#define TUNES_CLOSE_TIMEOUT 2000
+
 void
 suppressTuneDeviceOpenErrors (void) {
   openErrorLevel = LOG_DEBUG;
 }
 
-void
-closeTunes (void) {
+static void
+closeNoteDevice (void) {
+  if (noteDevice) {
+    noteMethods->destruct(noteDevice);
+    noteDevice = NULL;
+  }
+}
+
+static int
+playTuneElements (const TuneElement *element, const volatile int *interrupted) {
+  int ok = 1;
+
+  while (element->duration) {
+    if (interrupted && *interrupted) break;
+
+    if (!noteMethods->play(noteDevice, element->note, element->duration)) {
+      ok = 0;
+      break;
+    }
+
+    element += 1;
+  }
+
+  noteMethods->flush(noteDevice);
+  return ok;
+}
+
+#ifdef TUNE_THREAD_SUPPORTED
+/* Tunes are played on their own thread so that the main loop never waits
+ * for the note device. The thread also opens and closes the device since
+ * some devices (e.g. FM, whose port access is granted per thread) can only
+ * be used by the thread which opened them. The main thread waits to find
+ * out whether the device could be opened (so that it can still fall back
+ * to a dot pattern or a message) and hands the tune over. A newer tune
+ * replaces one which hasn't started yet, and cuts short the one being
+ * played at its next note. The thread closes the device after it has been
+ * idle for a while.
+ */
+static struct {
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t condition;
+  pthread_cond_t opened;
+
+  const TuneElement *pending;
+  volatile int interrupted;
+
+  unsigned active:1;
+  unsigned stop:1;
+  unsigned open:1;
+} tuneThread = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .condition = PTHREAD_COND_INITIALIZER,
+  .opened = PTHREAD_COND_INITIALIZER
+};
+
+static int
+awaitTuneRequest (void) {
+  if (!noteDevice) return pthread_cond_wait(&tuneThread.condition, &tuneThread.mutex);
+
+  {
+    TimeValue now;
+    struct timespec timeout;
+
+    getCurrentTime(&now);
+    now.nanoseconds += (TUNES_CLOSE_TIMEOUT % MSECS_PER_SEC) * NSECS_PER_MSEC;
+    timeout.tv_sec = now.seconds + (TUNES_CLOSE_TIMEOUT / MSECS_PER_SEC) + (now.nanoseconds / NSECS_PER_SEC);
+    timeout.tv_nsec = now.nanoseconds % NSECS_PER_SEC;
+
+    return pthread_cond_timedwait(&tuneThread.condition, &tuneThread.mutex, &timeout);
+  }
+}
+
+static void *
+runTuneThread (void *argument) {
+  blockThreadSignals();
+
+  pthread_mutex_lock(&tuneThread.mutex);
+
+  while (1) {
+    const TuneElement *elements = tuneThread.pending;
+
+    if (tuneThread.open) {
+      pthread_mutex_unlock(&tuneThread.mutex);
+      if (!noteDevice) noteDevice = noteMethods->construct(openErrorLevel);
+      pthread_mutex_lock(&tuneThread.mutex);
+
+      tuneThread.open = 0;
+      pthread_cond_broadcast(&tuneThread.opened);
+      continue;
+    }
+
+    if (elements) {
+      tuneThread.pending = NULL;
+      tuneThread.interrupted = 0;
+      pthread_mutex_unlock(&tuneThread.mutex);
+
+      playTuneElements(elements, &tuneThread.interrupted);
+
+      pthread_mutex_lock(&tuneThread.mutex);
+      continue;
+    }
+
+    if (tuneThread.stop) break;
+
+    if (awaitTuneRequest() == ETIMEDOUT) {
+      if (!tuneThread.pending && !tuneThread.stop) closeNoteDevice();
+    }
+  }
+
+  closeNoteDevice();
+  pthread_mutex_unlock(&tuneThread.mutex);
+  return NULL;
+}
+
+static void
+stopTuneThreadInChild (void) {
+  tuneThread.active = 0;
+  pthread_mutex_init(&tuneThread.mutex, NULL);
+  pthread_cond_init(&tuneThread.condition, NULL);
+  pthread_cond_init(&tuneThread.opened, NULL);
+}
+
+static int
+startTuneThread (void) {
+  static int prepared = 0;
+
+  if (tuneThread.active) return 1;
+
+  if (!prepared) {
+    if (!onThreadFork(stopTuneThreadInChild)) return 0;
+    prepared = 1;
+  }
+
+  /* the thread must open its own device */
   if (tunesCloseTimer) {
     asyncCancelRequest(tunesCloseTimer);
     tunesCloseTimer = NULL;
   }
+  closeNoteDevice();
+
+  tuneThread.pending = NULL;
+  tuneThread.interrupted = 0;
+  tuneThread.stop = 0;
+  tuneThread.open = 0;
+
+  {
+    int error = pthread_create(&tuneThread.thread, NULL, runTuneThread, NULL);
+
+    if (!error) {
+      tuneThread.active = 1;
+      return 1;
+    }
+
+    errno = error;
+    logSystemError("pthread_create");
+  }
+
+  return 0;
+}
+
+static void
+stopTuneThread (void) {
+  if (tuneThread.active) {
+    pthread_mutex_lock(&tuneThread.mutex);
+    tuneThread.stop = 1;
+    pthread_cond_signal(&tuneThread.condition);
+    pthread_mutex_unlock(&tuneThread.mutex);
+
+    /* the tune which has already been handed over is allowed to finish,
+     * and then the thread closes the device
+     */
+    pthread_join(tuneThread.thread, NULL);
+    tuneThread.active = 0;
+  }
+}
+
+static int
+queueTune (const TuneElement *elements) {
+  int queued = 0;
+
+  pthread_mutex_lock(&tuneThread.mutex);
+
+  if (!noteDevice) {
+    tuneThread.open = 1;
+    pthread_cond_signal(&tuneThread.condition);
+
+    while (tuneThread.open) {
+      pthread_cond_wait(&tuneThread.opened, &tuneThread.mutex);
+    }
+  }
 
   if (noteDevice) {
-    noteMethods->destruct(noteDevice);
-    noteDevice = NULL;
+    tuneThread.pending = elements;
+    tuneThread.interrupted = 1;
+    pthread_cond_signal(&tuneThread.condition);
+    queued = 1;
   }
+
+  pthread_mutex_unlock(&tuneThread.mutex);
+  return queued;
+}
+#endif /* TUNE_THREAD_SUPPORTED */
+
+void
+closeTunes (void) {
+#ifdef TUNE_THREAD_SUPPORTED
+  stopTuneThread();
+#endif /* TUNE_THREAD_SUPPORTED */
+
+  if (tunesCloseTimer) {
+    asyncCancelRequest(tunesCloseTimer);
+    tunesCloseTimer = NULL;
+  }
+
+  closeNoteDevice();
 }
 
 static void
@@ -344,12 +559,10 @@ handleTunesTimeout (const AsyncAlarmResult *result) {
  
 static int
 openTunes (void) {
-  const int timeout = 2000;
-
   if (noteDevice) {
-    asyncResetAlarmIn(tunesCloseTimer, timeout);
+    asyncResetAlarmIn(tunesCloseTimer, TUNES_CLOSE_TIMEOUT);
   } else if ((noteDevice = noteMethods->construct(openErrorLevel)) != NULL) {
-    asyncSetAlarmIn(&tunesCloseTimer, timeout, handleTunesTimeout, NULL);
+    asyncSetAlarmIn(&tunesCloseTimer, TUNES_CLOSE_TIMEOUT, handleTunesTimeout, NULL);
   } else {
     return 0;
   }
@@ -406,21 +619,14 @@ playTune (const TuneDefinition *tune) {
     int tunePlayed = 0;
 
     if (prefs.alertTunes && tune->elements) {
-      if (openTunes()) {
-        const TuneElement *element = tune->elements;
-
-        tunePlayed = 1;
-
-        while (element->duration) {
-          if (!noteMethods->play(noteDevice, element->note, element->duration)) {
-            tunePlayed = 0;
-            break;
-          }
+#ifdef TUNE_THREAD_SUPPORTED
+      if (startTuneThread()) {
+        tunePlayed = queueTune(tune->elements);
+      } else
+#endif /* TUNE_THREAD_SUPPORTED */
 
-          element += 1;
-        }
-
-        noteMethods->flush(noteDevice);
+      if (openTunes()) {
+        tunePlayed = playTuneElements(tune->elements, NULL);
       }
     }
 
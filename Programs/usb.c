@@ -248,6 +248,21 @@ usbDeviceDescriptor (UsbDevice *device) {
   return &device->descriptor;
 }
 
+const char *const *
+usbGetDriverCodes (uint16_t vendor, uint16_t product) {
+  const UsbDeviceEntry *entry = usbDeviceTable;
+
+  while (entry->vendor) {
+    if ((entry->vendor == vendor) && (entry->product == product)) {
+      return entry->driverCodes;
+    }
+
+    entry += 1;
+  }
+
+  return NULL;
+}
+
 int
 usbGetConfiguration (
   UsbDevice *device,
@@ -504,6 +519,8 @@ usbGetEndpoint (UsbDevice *device, unsigned char endpointAddress) {
           endpoint->direction.input.completed = NULL;
           endpoint->direction.input.buffer = NULL;
           endpoint->direction.input.length = 0;
+          endpoint->direction.input.callback = NULL;
+          endpoint->direction.input.callbackData = NULL;
           break;
       }
 
@@ -737,11 +754,40 @@ usbBeginInput (
       while ((actual = getQueueSize(endpoint->direction.input.pending)) < count)
         if (!usbAddPendingInputRequest(endpoint))
           break;
+
+      if (actual) endpoint->direction.input.monitored = usbMonitorInputRequests(device);
     }
   }
   return actual;
 }
 
+/* Takes the next response to an input request, and replaces the request.
+ * Returns 1 if input has arrived or if an error has occurred. */
+static int
+usbTestInputResponse (void *data) {
+  UsbEndpoint *endpoint = data;
+  UsbResponse response;
+  void *request;
+
+  while ((request = usbReapResponse(endpoint->device,
+                                    endpoint->descriptor->bEndpointAddress,
+                                    &response, 0))) {
+    usbAddPendingInputRequest(endpoint);
+    deleteItem(endpoint->direction.input.pending, request);
+
+    if (response.count > 0) {
+      endpoint->direction.input.buffer = response.buffer;
+      endpoint->direction.input.length = response.count;
+      endpoint->direction.input.completed = request;
+      return 1;
+    }
+
+    free(request);
+  }
+
+  return errno != EAGAIN;
+}
+
 int
 usbAwaitInput (
   UsbDevice *device,
@@ -754,6 +800,34 @@ usbAwaitInput (
   if (!(endpoint = usbGetInputEndpoint(device, endpointNumber))) return 0;
   if (endpoint->direction.input.completed) return 1;
 
+  if (!endpoint->direction.input.pending) {
+    /* keep requests in flight if their completions can be waited for, but
+     * only on interrupt endpoints (as usbFindChannel does unless told
+     * otherwise) since bulk ones, e.g. those of serial adapters which send
+     * their status every few milliseconds, would then complete all the time
+     */
+    if (USB_ENDPOINT_TRANSFER(endpoint->descriptor) == UsbEndpointTransfer_Interrupt) {
+      if (usbMonitorInputRequests(device)) {
+        usbBeginInput(device, endpointNumber, USB_DEFAULT_INPUT_REQUESTS);
+      }
+    }
+  }
+
+  if (endpoint->direction.input.monitored &&
+      endpoint->direction.input.pending &&
+      getQueueSize(endpoint->direction.input.pending)) {
+    /* completed requests are reaped by the async event loop */
+    if (!usbTestInputResponse(endpoint)) {
+      if (!timeout) return 0;
+      if (!asyncAwaitCondition(timeout, usbTestInputResponse, endpoint)) {
+        errno = EAGAIN;
+        return 0;
+      }
+    }
+
+    return endpoint->direction.input.completed != NULL;
+  }
+
   if (!timeout) {
     errno = EAGAIN;
     return 0;
@@ -807,31 +881,58 @@ usbAwaitInput (
 
     if (timeout) startTimePeriod(&period, timeout);
 
-    while (1) {
-      UsbResponse response;
-      void *request;
+    while (!usbTestInputResponse(endpoint)) {
+      if (afterTimePeriod(&period, NULL)) return 0;
+      asyncWait(interval);
+    }
 
-      while (!(request = usbReapResponse(device,
-                                         endpointNumber | UsbEndpointDirection_Input,
-                                         &response, 0))) {
-        if (errno != EAGAIN) return 0;
-        if (!timeout) return 0;
-        if (afterTimePeriod(&period, NULL)) return 0;
-        asyncWait(interval);
-      }
+    return endpoint->direction.input.completed != NULL;
+  }
+}
 
-      usbAddPendingInputRequest(endpoint);
-      deleteItem(endpoint->direction.input.pending, request);
+int
+usbMonitorInputEndpoint (
+  UsbDevice *device,
+  unsigned char endpointNumber,
+  AsyncMonitorCallback callback,
+  void *data
+) {
+  UsbEndpoint *endpoint = usbGetInputEndpoint(device, endpointNumber);
 
-      if (response.count > 0) {
-        endpoint->direction.input.buffer = response.buffer;
-        endpoint->direction.input.length = response.count;
-        endpoint->direction.input.completed = request;
-        return 1;
-      }
+  if (!endpoint) return 0;
+  endpoint->direction.input.callback = NULL;
+  endpoint->direction.input.callbackData = NULL;
+  if (!callback) return 1;
 
-      free(request);
-    }
+  if (!endpoint->direction.input.pending) {
+    usbBeginInput(device, endpointNumber, USB_DEFAULT_INPUT_REQUESTS);
+  }
+
+  if (!endpoint->direction.input.monitored) {
+    logMessage(LOG_DEBUG, "USB input endpoint can't be monitored: %02X",
+               endpoint->descriptor->bEndpointAddress);
+    errno = ENOSYS;
+    return 0;
+  }
+
+  endpoint->direction.input.callback = callback;
+  endpoint->direction.input.callbackData = data;
+  return 1;
+}
+
+void
+usbNotifyInputEndpoint (UsbEndpoint *endpoint) {
+  AsyncMonitorCallback callback = endpoint->direction.input.callback;
+
+  /* the callback's own reads may run the event loop */
+  if (callback && !endpoint->direction.input.notifying) {
+    const AsyncMonitorResult result = {
+      .data = endpoint->direction.input.callbackData
+    };
+
+    endpoint->direction.input.notifying = 1;
+    if (!callback(&result)) endpoint->direction.input.callback = NULL;
+    endpoint->direction.input.notifying = 0;
   }
 }
 
@@ -927,6 +1028,12 @@ usbChooseChannel (UsbDevice *device, void *data) {
                   if (!device->serialOperations->enableAdapter(device))
                     ok = 0;
 
+            if (ok)
+              if (definition->lowLatency)
+                if (device->serialOperations)
+                  if (device->serialOperations->setLowLatency)
+                    device->serialOperations->setLowLatency(device);
+
             if (ok)
               if (definition->serial)
                 if (!usbSetSerialParameters(device, definition->serial))
@@ -938,8 +1045,16 @@ usbChooseChannel (UsbDevice *device, void *data) {
 
                 if (!endpoint) {
                   ok = 0;
-                } else if (USB_ENDPOINT_TRANSFER(endpoint->descriptor) == UsbEndpointTransfer_Interrupt) {
-                  usbBeginInput(device, definition->inputEndpoint, 8);
+                } else {
+                  int count = definition->inputRequests;
+
+                  if (!count) {
+                    if (USB_ENDPOINT_TRANSFER(endpoint->descriptor) == UsbEndpointTransfer_Interrupt) {
+                      count = USB_DEFAULT_INPUT_REQUESTS;
+                    }
+                  }
+
+                  if (count) usbBeginInput(device, definition->inputEndpoint, count);
                 }
               }
             }
@@ -589,6 +589,11 @@ usbCancelRequest (
   return 0;
 }
 
+int
+usbMonitorInputRequests (UsbDevice *device) {
+  return 0;
+}
+
 void *
 usbReapResponse (
   UsbDevice *device,
@@ -623,6 +623,11 @@ usbCancelRequest (
   return 0;
 }
 
+int
+usbMonitorInputRequests (UsbDevice *device) {
+  return 0;
+}
+
 void *
 usbReapResponse (
   UsbDevice *device,
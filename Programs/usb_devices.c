@@ -0,0 +1,317 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2013 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://mielke.cc/brltty/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include "io_usb.h"
+#include "usb_internal.h"
+
+/* This table is maintained by updusbdevs - don't edit it by hand. */
+const UsbDeviceEntry usbDeviceTable[] = {
+  /* BEGIN_USB_DEVICES */
+
+  /* Device: 0403:6001 */
+  /* Generic Identifier */
+  /* Vendor: Future Technology Devices International, Ltd */
+  /* Product: FT232 USB-Serial (UART) IC */
+  /* Albatross [all models] */
+  /* Cebra [all models] */
+  /* HIMS [Sync Braille] */
+  /* HandyTech [FTDI chip] */
+  { .vendor=0X0403, .product=0X6001, .driverCodes=(const char *const []){"at", "ce", "hm", "ht", NULL} },
+
+  /* Device: 0403:F208 */
+  /* Papenmeier [all models] */
+  { .vendor=0X0403, .product=0XF208, .driverCodes=(const char *const []){"pm", NULL} },
+
+  /* Device: 0403:FE70 */
+  /* Baum [Vario40 (40 cells)] */
+  { .vendor=0X0403, .product=0XFE70, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0403:FE71 */
+  /* Baum [PocketVario (24 cells)] */
+  { .vendor=0X0403, .product=0XFE71, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0403:FE72 */
+  /* Baum [SuperVario 40 (40 cells)] */
+  { .vendor=0X0403, .product=0XFE72, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0403:FE73 */
+  /* Baum [SuperVario 32 (32 cells)] */
+  { .vendor=0X0403, .product=0XFE73, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0403:FE74 */
+  /* Baum [SuperVario 64 (64 cells)] */
+  { .vendor=0X0403, .product=0XFE74, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0403:FE75 */
+  /* Baum [SuperVario 80 (80 cells)] */
+  { .vendor=0X0403, .product=0XFE75, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0403:FE76 */
+  /* Baum [VarioPro 80 (80 cells)] */
+  { .vendor=0X0403, .product=0XFE76, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0403:FE77 */
+  /* Baum [VarioPro 64 (64 cells)] */
+  { .vendor=0X0403, .product=0XFE77, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0452:0100 */
+  /* Metec [all models] */
+  { .vendor=0X0452, .product=0X0100, .driverCodes=(const char *const []){"mt", NULL} },
+
+  /* Device: 045E:930A */
+  /* HIMS [Braille Sense (USB 1.1)] */
+  /* HIMS [Braille Sense (USB 2.0)] */
+  /* HIMS [Braille Sense U2 (USB 2.0)] */
+  { .vendor=0X045E, .product=0X930A, .driverCodes=(const char *const []){"hm", NULL} },
+
+  /* Device: 045E:930B */
+  /* HIMS [Braille Edge] */
+  { .vendor=0X045E, .product=0X930B, .driverCodes=(const char *const []){"hm", NULL} },
+
+  /* Device: 06B0:0001 */
+  /* Alva [Satellite (5nn)] */
+  { .vendor=0X06B0, .product=0X0001, .driverCodes=(const char *const []){"al", NULL} },
+
+  /* Device: 0798:0001 */
+  /* Voyager [all models] */
+  { .vendor=0X0798, .product=0X0001, .driverCodes=(const char *const []){"vo", NULL} },
+
+  /* Device: 0798:0624 */
+  /* Alva [BC624] */
+  { .vendor=0X0798, .product=0X0624, .driverCodes=(const char *const []){"al", NULL} },
+
+  /* Device: 0798:0640 */
+  /* Alva [BC640] */
+  { .vendor=0X0798, .product=0X0640, .driverCodes=(const char *const []){"al", NULL} },
+
+  /* Device: 0798:0680 */
+  /* Alva [BC680] */
+  { .vendor=0X0798, .product=0X0680, .driverCodes=(const char *const []){"al", NULL} },
+
+  /* Device: 0904:2000 */
+  /* Baum [VarioPro 40 (40 cells)] */
+  { .vendor=0X0904, .product=0X2000, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2001 */
+  /* Baum [EcoVario 24 (24 cells)] */
+  { .vendor=0X0904, .product=0X2001, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2002 */
+  /* Baum [EcoVario 40 (40 cells)] */
+  { .vendor=0X0904, .product=0X2002, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2007 */
+  /* Baum [VarioConnect 40 (40 cells)] */
+  { .vendor=0X0904, .product=0X2007, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2008 */
+  /* Baum [VarioConnect 32 (32 cells)] */
+  { .vendor=0X0904, .product=0X2008, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2009 */
+  /* Baum [VarioConnect 24 (24 cells)] */
+  { .vendor=0X0904, .product=0X2009, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2010 */
+  /* Baum [VarioConnect 64 (64 cells)] */
+  { .vendor=0X0904, .product=0X2010, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2011 */
+  /* Baum [VarioConnect 80 (80 cells)] */
+  { .vendor=0X0904, .product=0X2011, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2014 */
+  /* Baum [EcoVario 32 (32 cells)] */
+  { .vendor=0X0904, .product=0X2014, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2015 */
+  /* Baum [EcoVario 64 (64 cells)] */
+  { .vendor=0X0904, .product=0X2015, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:2016 */
+  /* Baum [EcoVario 80 (80 cells)] */
+  { .vendor=0X0904, .product=0X2016, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0904:3000 */
+  /* Baum [Refreshabraille 18 (18 cells)] */
+  { .vendor=0X0904, .product=0X3000, .driverCodes=(const char *const []){"bm", NULL} },
+
+  /* Device: 0921:1200 */
+  /* HandyTech [GoHubs chip] */
+  { .vendor=0X0921, .product=0X1200, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 0F4E:0100 */
+  /* FreedomScientific [Focus 1] */
+  { .vendor=0X0F4E, .product=0X0100, .driverCodes=(const char *const []){"fs", NULL} },
+
+  /* Device: 0F4E:0111 */
+  /* FreedomScientific [PAC Mate] */
+  { .vendor=0X0F4E, .product=0X0111, .driverCodes=(const char *const []){"fs", NULL} },
+
+  /* Device: 0F4E:0112 */
+  /* FreedomScientific [Focus 2] */
+  { .vendor=0X0F4E, .product=0X0112, .driverCodes=(const char *const []){"fs", NULL} },
+
+  /* Device: 0F4E:0114 */
+  /* FreedomScientific [Focus Blue] */
+  { .vendor=0X0F4E, .product=0X0114, .driverCodes=(const char *const []){"fs", NULL} },
+
+  /* Device: 10C4:EA60 */
+  /* Generic Identifier */
+  /* Vendor: Cygnal Integrated Products, Inc. */
+  /* Product: CP210x UART Bridge / myAVR mySmartUSB light */
+  /* Seika [Braille Display] */
+  { .vendor=0X10C4, .product=0XEA60, .driverCodes=(const char *const []){"sk", NULL} },
+
+  /* Device: 10C4:EA80 */
+  /* Generic Identifier */
+  /* Vendor: Cygnal Integrated Products, Inc. */
+  /* Product: CP210x UART Bridge */
+  /* Seika [Note Taker] */
+  { .vendor=0X10C4, .product=0XEA80, .driverCodes=(const char *const []){"sk", NULL} },
+
+  /* Device: 1C71:C005 */
+  /* HumanWare [all models] */
+  { .vendor=0X1C71, .product=0XC005, .driverCodes=(const char *const []){"hw", NULL} },
+
+  /* Device: 1FE4:0003 */
+  /* HandyTech [USB-HID adapter] */
+  { .vendor=0X1FE4, .product=0X0003, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0044 */
+  /* HandyTech [Easy Braille (HID)] */
+  { .vendor=0X1FE4, .product=0X0044, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0054 */
+  /* HandyTech [Active Braille] */
+  { .vendor=0X1FE4, .product=0X0054, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0074 */
+  /* HandyTech [Braille Star 40 (HID)] */
+  { .vendor=0X1FE4, .product=0X0074, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0081 */
+  /* HandyTech [Basic Braille 16] */
+  { .vendor=0X1FE4, .product=0X0081, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0082 */
+  /* HandyTech [Basic Braille 20] */
+  { .vendor=0X1FE4, .product=0X0082, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0083 */
+  /* HandyTech [Basic Braille 32] */
+  { .vendor=0X1FE4, .product=0X0083, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0084 */
+  /* HandyTech [Basic Braille 40] */
+  { .vendor=0X1FE4, .product=0X0084, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0086 */
+  /* HandyTech [Basic Braille 64] */
+  { .vendor=0X1FE4, .product=0X0086, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:0087 */
+  /* HandyTech [Basic Braille 80] */
+  { .vendor=0X1FE4, .product=0X0087, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:008A */
+  /* HandyTech [Basic Braille 48] */
+  { .vendor=0X1FE4, .product=0X008A, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 1FE4:008B */
+  /* HandyTech [Basic Braille 160] */
+  { .vendor=0X1FE4, .product=0X008B, .driverCodes=(const char *const []){"ht", NULL} },
+
+  /* Device: 4242:0001 */
+  /* Pegasus [all models] */
+  { .vendor=0X4242, .product=0X0001, .driverCodes=(const char *const []){"pg", NULL} },
+
+  /* Device: C251:1122 */
+  /* EuroBraille [Esys (version < 3.0, no SD card)] */
+  { .vendor=0XC251, .product=0X1122, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1123 */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X1123, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1124 */
+  /* EuroBraille [Esys (version < 3.0, with SD card)] */
+  { .vendor=0XC251, .product=0X1124, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1125 */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X1125, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1126 */
+  /* EuroBraille [Esys (version >= 3.0, no SD card)] */
+  { .vendor=0XC251, .product=0X1126, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1127 */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X1127, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1128 */
+  /* EuroBraille [Esys (version >= 3.0, with SD card)] */
+  { .vendor=0XC251, .product=0X1128, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1129 */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X1129, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:112A */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X112A, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:112B */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X112B, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:112C */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X112C, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:112D */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X112D, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:112E */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X112E, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:112F */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X112F, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1130 */
+  /* EuroBraille [Esytime] */
+  { .vendor=0XC251, .product=0X1130, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1131 */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X1131, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* Device: C251:1132 */
+  /* EuroBraille [reserved] */
+  { .vendor=0XC251, .product=0X1132, .driverCodes=(const char *const []){"eu", NULL} },
+
+  /* END_USB_DEVICES */
+
+  { .vendor = 0 }
+};
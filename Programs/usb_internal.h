@@ -30,6 +30,14 @@ typedef struct {
   UsbInputFilter filter;
 } UsbInputFilterEntry;
 
+typedef struct {
+  uint16_t vendor;
+  uint16_t product;
+  const char *const *driverCodes;
+} UsbDeviceEntry;
+
+extern const UsbDeviceEntry usbDeviceTable[];
+
 typedef struct UsbEndpointExtensionStruct UsbEndpointExtension;
 
 typedef struct {
@@ -40,9 +48,14 @@ typedef struct {
   union {
     struct {
       Queue *pending;
+      unsigned monitored:1;
+      unsigned notifying:1;
       void *completed;
       unsigned char *buffer;
       size_t length;
+
+      AsyncMonitorCallback callback;
+      void *callbackData;
     } input;
 
     struct {
@@ -111,6 +124,17 @@ extern ssize_t usbControlTransfer (
   int timeout
 );
 
+/* Arranges for completed requests to be reaped from the async event loop,
+ * returns 0 if they can only be polled for on this platform */
+extern int usbMonitorInputRequests (UsbDevice *device);
+
+/* Called by the platform, from the async event loop, when input requests
+ * on the endpoint have completed */
+extern void usbNotifyInputEndpoint (UsbEndpoint *endpoint);
+
+/* How many input requests are kept in flight unless otherwise specified */
+#define USB_DEFAULT_INPUT_REQUESTS 8
+
 extern int usbReadDeviceDescriptor (UsbDevice *device);
 extern int usbAllocateEndpointExtension (UsbEndpoint *endpoint);
 extern void usbDeallocateEndpointExtension (UsbEndpointExtension *eptx);
@@ -27,6 +27,8 @@
 #include <sys/stat.h>
 #include <sys/vfs.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 #include <linux/usbdevice_fs.h>
 
 #ifndef USBDEVFS_DISCONNECT
@@ -50,13 +52,20 @@ typedef struct {
   char *sysfsPath;
   char *usbfsPath;
   UsbDeviceDescriptor usbDescriptor;
+  unsigned int references;
 } UsbHostDevice;
 
 static Queue *usbHostDevices = NULL;
+static char *usbHostDevicesRoot = NULL;
+static int usbHostDevicesStale = 0;
+
+static int usbHostDeviceSocket = -1;
+static AsyncHandle usbHostDeviceMonitor = NULL;
 
 struct UsbDeviceExtensionStruct {
-  const UsbHostDevice *host;
+  UsbHostDevice *host;
   int usbfsFile;
+  AsyncHandle requestMonitor;
 };
 
 struct UsbEndpointExtensionStruct {
@@ -78,6 +87,11 @@ usbOpenUsbfsFile (UsbDeviceExtension *devx) {
 
 static void
 usbCloseUsbfsFile (UsbDeviceExtension *devx) {
+  if (devx->requestMonitor) {
+    asyncCancelRequest(devx->requestMonitor);
+    devx->requestMonitor = NULL;
+  }
+
   if (devx->usbfsFile != -1) {
     close(devx->usbfsFile);
     devx->usbfsFile = -1;
@@ -515,6 +529,56 @@ usbCancelRequest (
   return 0;
 }
 
+static int
+usbNotifyCompletedInput (void *item, void *data) {
+  UsbEndpoint *endpoint = item;
+
+  if (USB_ENDPOINT_DIRECTION(endpoint->descriptor) == UsbEndpointDirection_Input) {
+    UsbEndpointExtension *eptx = endpoint->extension;
+
+    if (getQueueSize(eptx->completedRequests)) usbNotifyInputEndpoint(endpoint);
+  }
+
+  return 0;
+}
+
+static int
+usbHandleCompletedRequests (const AsyncMonitorResult *result) {
+  UsbDevice *device = result->data;
+  UsbDeviceExtension *devx = device->extension;
+
+  /* usbfs is writable while there are completed URBs to reap */
+  while (usbReapUrb(device, 0));
+
+  if (errno == EAGAIN) {
+    processQueue(device->endpoints, usbNotifyCompletedInput, NULL);
+    return 1;
+  }
+
+  logMessage(LOG_WARNING, "USB request monitor stopped");
+  asyncDiscardHandle(devx->requestMonitor);
+  devx->requestMonitor = NULL;
+  return 0;
+}
+
+int
+usbMonitorInputRequests (UsbDevice *device) {
+  UsbDeviceExtension *devx = device->extension;
+
+  if (devx->requestMonitor) return 1;
+
+  if (usbOpenUsbfsFile(devx)) {
+    if (asyncMonitorFileOutput(&devx->requestMonitor, devx->usbfsFile,
+                               usbHandleCompletedRequests, device)) {
+      return 1;
+    }
+
+    devx->requestMonitor = NULL;
+  }
+
+  return 0;
+}
+
 void *
 usbReapResponse (
   UsbDevice *device,
@@ -752,19 +816,25 @@ usbDeallocateEndpointExtension (UsbEndpointExtension *eptx) {
   free(eptx);
 }
 
-void
-usbDeallocateDeviceExtension (UsbDeviceExtension *devx) {
-  usbCloseUsbfsFile(devx);
-  free(devx);
+static void
+usbReleaseHostDevice (UsbHostDevice *host) {
+  if (!--host->references) {
+    if (host->sysfsPath) free(host->sysfsPath);
+    if (host->usbfsPath) free(host->usbfsPath);
+    free(host);
+  }
 }
 
 static void
 usbDeallocateHostDevice (void *item, void *data) {
-  UsbHostDevice *host = item;
+  usbReleaseHostDevice(item);
+}
 
-  if (host->sysfsPath) free(host->sysfsPath);
-  if (host->usbfsPath) free(host->usbfsPath);
-  free(host);
+void
+usbDeallocateDeviceExtension (UsbDeviceExtension *devx) {
+  usbCloseUsbfsFile(devx);
+  usbReleaseHostDevice(devx->host);
+  free(devx);
 }
 
 typedef struct {
@@ -775,13 +845,14 @@ typedef struct {
 
 static int
 usbTestHostDevice (void *item, void *data) {
-  const UsbHostDevice *host = item;
+  UsbHostDevice *host = item;
   UsbTestHostDeviceData *test = data;
   UsbDeviceExtension *devx;
 
   if ((devx = malloc(sizeof(*devx)))) {
     memset(devx, 0, sizeof(*devx));
     devx->host = host;
+    host->references += 1;
     devx->usbfsFile = -1;
 
     if ((test->device = usbTestDevice(devx, test->chooser, test->data))) return 1;
@@ -899,6 +970,8 @@ usbAddHostDevice (const char *path) {
   UsbHostDevice *host;
 
   if ((host = malloc(sizeof(*host)))) {
+    host->references = 1;
+
     if ((host->usbfsPath = strdup(path))) {
       host->sysfsPath = usbMakeSysfsPath(host->usbfsPath);
 
@@ -956,6 +1029,168 @@ usbAddHostDevices (const char *root) {
   return ok;
 }
 
+static int
+usbTestHostDevicePath (const void *item, const void *data) {
+  const UsbHostDevice *host = item;
+  const char *path = data;
+
+  return strcmp(host->usbfsPath, path) == 0;
+}
+
+static void
+usbRemoveHostDevice (const char *path) {
+  Element *element = findElement(usbHostDevices, usbTestHostDevicePath, path);
+
+  if (element) deleteElement(element);
+}
+
+static void
+usbHandleHostDeviceEvent (const char *buffer, size_t length) {
+  const char *end = buffer + length;
+  const char *string = buffer;
+  const char *action = NULL;
+  const char *subsystem = NULL;
+  const char *type = NULL;
+  const char *bus = NULL;
+  const char *device = NULL;
+
+  while (string < end) {
+    size_t size = strlen(string) + 1;
+
+    if (!action) {
+      if (!strchr(string, '@')) return;
+      action = string;
+    } else {
+      const char *value = strchr(string, '=');
+
+      if (value) {
+        size_t nameLength = value++ - string;
+
+#define USB_UEVENT_KEY(key, variable) \
+  if ((nameLength == (sizeof(key) - 1)) && (memcmp(string, key, nameLength) == 0)) variable = value
+
+        USB_UEVENT_KEY("SUBSYSTEM", subsystem);
+        else USB_UEVENT_KEY("DEVTYPE", type);
+        else USB_UEVENT_KEY("BUSNUM", bus);
+        else USB_UEVENT_KEY("DEVNUM", device);
+#undef USB_UEVENT_KEY
+      }
+    }
+
+    string += size;
+  }
+
+  if (!subsystem || (strcmp(subsystem, "usb") != 0)) return;
+  if (!type || (strcmp(type, "usb_device") != 0)) return;
+
+  if (!bus || !device) {
+    usbHostDevicesStale = 1;
+    return;
+  }
+
+  {
+    char path[strlen(usbHostDevicesRoot) + strlen(bus) + strlen(device) + 3];
+    int isAdd = strncmp(action, "add@", 4) == 0;
+
+    if (!isAdd && (strncmp(action, "remove@", 7) != 0)) return;
+    snprintf(path, sizeof(path), "%s/%s/%s", usbHostDevicesRoot, bus, device);
+    logMessage(LOG_DEBUG, "USB host device %s: %s", (isAdd? "added": "removed"), path);
+    usbRemoveHostDevice(path);
+
+    if (isAdd) {
+      if (!usbAddHostDevice(path) ||
+          !findElement(usbHostDevices, usbTestHostDevicePath, path)) {
+        usbHostDevicesStale = 1;
+      }
+    }
+  }
+}
+
+static void
+usbStopHostDeviceMonitor (void) {
+  if (usbHostDeviceMonitor) {
+    asyncCancelRequest(usbHostDeviceMonitor);
+    usbHostDeviceMonitor = NULL;
+  }
+
+  if (usbHostDeviceSocket != -1) {
+    close(usbHostDeviceSocket);
+    usbHostDeviceSocket = -1;
+  }
+}
+
+static int
+usbReadHostDeviceEvent (int monitoring) {
+  /* the kernel limits each uevent message to UEVENT_BUFFER_SIZE (2048) */
+  char buffer[0X1000];
+  ssize_t length = recv(usbHostDeviceSocket, buffer, sizeof(buffer)-1, MSG_DONTWAIT);
+
+  if (length == -1) {
+    if ((errno == EAGAIN) || (errno == EINTR)) return 0;
+
+    if (errno == ENOBUFS) {
+      /* uevents were dropped - rescan before the next device search */
+      usbHostDevicesStale = 1;
+      return 1;
+    }
+
+    logSystemError("USB host device monitor");
+
+    if (monitoring) {
+      /* the monitor itself is removed when its callback returns 0 */
+      asyncDiscardHandle(usbHostDeviceMonitor);
+      usbHostDeviceMonitor = NULL;
+    }
+
+    usbStopHostDeviceMonitor();
+    usbHostDevicesStale = 1;
+    return 0;
+  }
+
+  buffer[length] = 0;
+  if (usbHostDevices) usbHandleHostDeviceEvent(buffer, length);
+  return 1;
+}
+
+static int
+usbMonitorHostDeviceEvents (const AsyncMonitorResult *result) {
+  usbReadHostDeviceEvent(1);
+  return usbHostDeviceMonitor != NULL;
+}
+
+static int
+usbStartHostDeviceMonitor (void) {
+#ifdef NETLINK_KOBJECT_UEVENT
+  if (usbHostDeviceMonitor) return 1;
+
+  if ((usbHostDeviceSocket = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT)) != -1) {
+    const struct sockaddr_nl socketAddress = {
+      .nl_family = AF_NETLINK,
+      .nl_pid = 0,
+      .nl_groups = 0X1
+    };
+
+    if (bind(usbHostDeviceSocket, (const struct sockaddr *)&socketAddress, sizeof(socketAddress)) != -1) {
+      if (asyncMonitorFileInput(&usbHostDeviceMonitor, usbHostDeviceSocket,
+                                usbMonitorHostDeviceEvents, NULL)) {
+        return 1;
+      }
+
+      usbHostDeviceMonitor = NULL;
+    } else {
+      logSystemError("bind");
+    }
+
+    close(usbHostDeviceSocket);
+    usbHostDeviceSocket = -1;
+  } else {
+    logSystemError("socket");
+  }
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+  return 0;
+}
+
 typedef int (*FileSystemVerifier) (const char *path);
 
 typedef struct {
@@ -1049,27 +1284,44 @@ usbGetUsbfs (void) {
   return usbGetFileSystem("usbfs", usbfsCandidates, usbTestUsbfs, usbVerifyUsbfs);
 }
 
+static void
+usbDeallocateHostDevices (void) {
+  if (usbHostDevices) {
+    deallocateQueue(usbHostDevices);
+    usbHostDevices = NULL;
+  }
+
+  if (usbHostDevicesRoot) {
+    free(usbHostDevicesRoot);
+    usbHostDevicesRoot = NULL;
+  }
+}
+
 UsbDevice *
 usbFindDevice (UsbDeviceChooser chooser, void *data) {
+  /* apply hotplug events which arrived since the event loop last ran */
+  if (usbHostDeviceMonitor) while (usbReadHostDeviceEvent(0));
+
+  if (usbHostDevicesStale) {
+    usbHostDevicesStale = 0;
+    usbDeallocateHostDevices();
+  }
+
   if (!usbHostDevices) {
     int ok = 0;
 
     if ((usbHostDevices = newQueue(usbDeallocateHostDevice, NULL))) {
-      char *root;
+      if ((usbHostDevicesRoot = usbGetUsbfs())) {
+        logMessage(LOG_DEBUG, "USBFS Root: %s", usbHostDevicesRoot);
 
-      if ((root = usbGetUsbfs())) {
-        logMessage(LOG_DEBUG, "USBFS Root: %s", root);
-        if (usbAddHostDevices(root)) ok = 1;
-
-        free(root);
+        /* start listening before the scan so that no hotplug event is missed */
+        usbStartHostDeviceMonitor();
+        if (usbAddHostDevices(usbHostDevicesRoot)) ok = 1;
       } else {
         logMessage(LOG_DEBUG, "USBFS not mounted");
       }
 
-      if (!ok) {
-        deallocateQueue(usbHostDevices);
-        usbHostDevices = NULL;
-      }
+      if (!ok) usbDeallocateHostDevices();
     }
   }
 
@@ -1088,8 +1340,6 @@ usbFindDevice (UsbDeviceChooser chooser, void *data) {
 
 void
 usbForgetDevices (void) {
-  if (usbHostDevices) {
-    deallocateQueue(usbHostDevices);
-    usbHostDevices = NULL;
-  }
+  /* the index is kept current by the hotplug monitor while it's running */
+  if (!usbHostDeviceMonitor) usbDeallocateHostDevices();
 }
@@ -452,6 +452,18 @@ usbSetRtsState_FTDI (UsbDevice *device, int state) {
   return usbSetModemState_FTDI(device, state, 1, "RTS");
 }
 
+static int
+usbSetLowLatency_FTDI_FT232BM (UsbDevice *device) {
+  /* The chip holds short input back for up to its latency timer
+   * (16ms by default) so lower it to what the kernel uses for low latency.
+   * It also sends a status packet whenever the timer expires, though,
+   * so this is only done for the channels which ask for it.
+   */
+  if (usbSetAttribute_FTDI(device, 9, 1, 0)) return 1;
+  logMessage(LOG_DEBUG, "cannot set FTDI latency timer: %s", strerror(errno));
+  return 0;
+}
+
 static const UsbSerialOperations usbSerialOperations_FTDI_SIO = {
   .setBaud = usbSetBaud_FTDI_SIO,
   .setDataFormat = usbSetDataFormat_FTDI,
@@ -473,7 +485,8 @@ static const UsbSerialOperations usbSerialOperations_FTDI_FT232BM = {
   .setDataFormat = usbSetDataFormat_FTDI,
   .setFlowControl = usbSetFlowControl_FTDI,
   .setDtrState = usbSetDtrState_FTDI,
-  .setRtsState = usbSetRtsState_FTDI
+  .setRtsState = usbSetRtsState_FTDI,
+  .setLowLatency = usbSetLowLatency_FTDI_FT232BM
 };
 
 
@@ -1029,7 +1042,7 @@ usbSetSerialOperations (UsbDevice *device) {
               const UsbEndpointDescriptor *endpoint = usbFindInterruptInputEndpoint(device, interface);
 
               if (endpoint) {
-                usbBeginInput(device, USB_ENDPOINT_NUMBER(endpoint), 8);
+                usbBeginInput(device, USB_ENDPOINT_NUMBER(endpoint), USB_DEFAULT_INPUT_REQUESTS);
               }
             }
 
@@ -298,6 +298,11 @@ usbCancelRequest (
   return 1;
 }
 
+int
+usbMonitorInputRequests (UsbDevice *device) {
+  return 0;
+}
+
 void *
 usbReapResponse (
   UsbDevice *device,
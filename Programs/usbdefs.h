@@ -310,8 +310,10 @@ typedef struct {
   unsigned char alternative;
   unsigned char inputEndpoint;
   unsigned char outputEndpoint;
+  unsigned char inputRequests; /* kept in flight, 0 for the default */
 
   unsigned disableAutosuspend:1;
+  unsigned lowLatency:1; /* minimize the serial adapter's input latency */
   const SerialParameters *serial;
   const void *data;
 } UsbChannelDefinition;